@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_channel.h"
 #include "data/data_histories.h"
 #include "data/data_peer.h"
+#include "data/data_search_index.h"
 #include "data/data_session.h"
 #include "history/history.h"
 #include "history/history_item.h"
@@ -78,6 +79,7 @@ void MessagesSearch::searchRequest() {
 			searchReceived(it->second, _requestId, nextToken);
 			return;
 		}
+		searchLocal(nextToken);
 	}
 	auto callback = [=](Fn<void()> finish) {
 		const auto flags = _from
@@ -124,6 +126,32 @@ void MessagesSearch::searchRequest() {
 		std::move(callback));
 }
 
+void MessagesSearch::searchLocal(const QString &nextToken) {
+	auto &owner = _history->owner();
+	const auto ids = owner.searchIndex().query(
+		_history->peer->id,
+		_query,
+		kSearchPerPage);
+	auto found = FoundMessages{ .nextToken = nextToken, .local = true };
+	for (const auto &id : ids) {
+		const auto item = owner.message(id);
+		if (!item) {
+			// Restored from the local storage, will be shown next time.
+			_history->session().api().requestMessageData(
+				_history->peer,
+				id.msg,
+				nullptr);
+		} else if (!_from || item->from() == _from) {
+			found.messages.push_back(id);
+		}
+	}
+	if (found.messages.empty()) {
+		return;
+	}
+	found.total = int(found.messages.size());
+	_messagesFounds.fire(std::move(found));
+}
+
 void MessagesSearch::searchReceived(
 		const TLMessages &result,
 		mtpRequestId requestId,
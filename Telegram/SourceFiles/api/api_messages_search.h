@@ -17,6 +17,7 @@ struct FoundMessages {
 	int total = -1;
 	MessageIdsList messages;
 	QString nextToken;
+	bool local = false;
 };
 
 class MessagesSearch final {
@@ -32,6 +33,7 @@ public:
 private:
 	using TLMessages = MTPmessages_Messages;
 	void searchRequest();
+	void searchLocal(const QString &nextToken);
 	void searchReceived(
 		const TLMessages &result,
 		mtpRequestId requestId,
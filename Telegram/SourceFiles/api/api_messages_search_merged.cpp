@@ -24,7 +24,11 @@ MessagesSearchMerged::MessagesSearchMerged(not_null<History*> history)
 	}
 	const auto checkWaitingForTotal = [=] {
 		if (_waitingForTotal) {
-			if (_concatedFound.total >= 0 && _migratedFirstFound.total >= 0) {
+			if (_concatedFound.local) {
+				// Show local results while waiting for the server ones.
+				_newFounds.fire({});
+			} else if (_concatedFound.total >= 0
+				&& _migratedFirstFound.total >= 0) {
 				_waitingForTotal = false;
 				_concatedFound.total += _migratedFirstFound.total;
 				_newFounds.fire({});
@@ -35,7 +39,9 @@ MessagesSearchMerged::MessagesSearchMerged(not_null<History*> history)
 	};
 
 	const auto checkFull = [=](const FoundMessages &data) {
-		if (data.total == int(_concatedFound.messages.size())) {
+		if (data.local) {
+			return;
+		} else if (data.total == int(_concatedFound.messages.size())) {
 			_isFull = true;
 			addFound(_migratedFirstFound);
 		}
@@ -43,7 +49,8 @@ MessagesSearchMerged::MessagesSearchMerged(not_null<History*> history)
 
 	_apiSearch.messagesFounds(
 	) | rpl::start_with_next([=](const FoundMessages &data) {
-		if (data.nextToken == _concatedFound.nextToken) {
+		if (data.nextToken == _concatedFound.nextToken
+			&& !_concatedFound.local) {
 			addFound(data);
 			checkFull(data);
 			_nextFounds.fire({});
@@ -56,7 +63,10 @@ MessagesSearchMerged::MessagesSearchMerged(not_null<History*> history)
 
 	if (_migratedSearch) {
 		_migratedSearch->messagesFounds(
-		) | rpl::start_with_next([=](const FoundMessages &data) {
+		) | rpl::filter([](const FoundMessages &data) {
+			// Local results are shown only for the main history.
+			return !data.local;
+		}) | rpl::start_with_next([=](const FoundMessages &data) {
 			if (_isFull) {
 				addFound(data);
 			}
@@ -110,6 +110,7 @@ constexpr auto kTopPromotionMinDelay = TimeId(10);
 constexpr auto kSmallDelayMs = 5;
 constexpr auto kReadFeaturedSetsTimeout = crl::time(1000);
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
+constexpr auto kFileLoaderQueueThreadsMax = 8;
 constexpr auto kStickersByEmojiInvalidateTimeout = crl::time(6 * 1000);
 constexpr auto kNotifySettingSaveTimeout = crl::time(1000);
 constexpr auto kDialogsFirstLoad = 20;
@@ -123,6 +124,13 @@ using UpdatedFileReferences = Data::UpdatedFileReferences;
 	return TimeId(msgId >> 32);
 }
 
+[[nodiscard]] int FileLoaderThreadsCount() {
+	return std::clamp(
+		QThread::idealThreadCount(),
+		1,
+		kFileLoaderQueueThreadsMax);
+}
+
 [[nodiscard]] std::shared_ptr<ChatHelpers::Show> ShowForPeer(
 		not_null<PeerData*> peer) {
 	if (const auto window = Core::App().windowFor(peer)) {
@@ -156,7 +164,9 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	FileLoaderThreadsCount()))
 , _topPromotionTimer([=] { refreshTopPromotion(); })
 , _updateNotifyTimer([=] { sendNotifySettingsUpdates(); })
 , _authorizations(std::make_unique<Api::Authorizations>(this))
@@ -567,12 +577,13 @@ void ApiWrap::sendMessageFail(
 void ApiWrap::requestMessageData(
 		PeerData *peer,
 		MsgId msgId,
-		Fn<void()> done) {
+		Fn<void()> done,
+		Fn<void()> fail) {
 	auto &requests = (peer && peer->isChannel())
 		? _channelMessageDataRequests[peer->asChannel()][msgId]
 		: _messageDataRequests[msgId];
-	if (done) {
-		requests.callbacks.push_back(std::move(done));
+	if (done || fail) {
+		requests.callbacks.push_back({ std::move(done), std::move(fail) });
 	}
 	if (!requests.requestId) {
 		_messageDataResolveDelayed.call();
@@ -624,7 +635,7 @@ void ApiWrap::resolveMessageDatas() {
 			_session->data().processExistingMessages(nullptr, result);
 			finalizeMessageDataRequest(nullptr, requestId);
 		}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
-			finalizeMessageDataRequest(nullptr, requestId);
+			finalizeMessageDataRequest(nullptr, requestId, true);
 		}).afterDelay(kSmallDelayMs).send();
 
 		for (auto &[msgId, request] : _messageDataRequests) {
@@ -651,7 +662,7 @@ void ApiWrap::resolveMessageDatas() {
 				_session->data().processExistingMessages(channel, result);
 				finalizeMessageDataRequest(channel, requestId);
 			}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
-				finalizeMessageDataRequest(channel, requestId);
+				finalizeMessageDataRequest(channel, requestId, true);
 			}).afterDelay(kSmallDelayMs).send();
 
 			for (auto &[msgId, request] : j->second) {
@@ -667,12 +678,13 @@ void ApiWrap::resolveMessageDatas() {
 
 void ApiWrap::finalizeMessageDataRequest(
 		ChannelData *channel,
-		mtpRequestId requestId) {
+		mtpRequestId requestId,
+		bool failed) {
 	auto requests = messageDataRequests(channel, true);
 	if (!requests) {
 		return;
 	}
-	auto callbacks = std::vector<Fn<void()>>();
+	auto callbacks = MessageDataRequest::Callbacks();
 	for (auto i = requests->begin(); i != requests->cend();) {
 		if (i->second.requestId == requestId) {
 			auto &list = i->second.callbacks;
@@ -693,7 +705,11 @@ void ApiWrap::finalizeMessageDataRequest(
 		_channelMessageDataRequests.remove(channel);
 	}
 	for (const auto &callback : callbacks) {
-		callback();
+		if (failed && callback.fail) {
+			callback.fail();
+		} else if (callback.done) {
+			callback.done();
+		}
 	}
 }
 
@@ -158,7 +158,12 @@ public:
 		bool archived,
 		Fn<void()> callback);
 
-	void requestMessageData(PeerData *peer, MsgId msgId, Fn<void()> done);
+	// If fail is set it is called instead of done when the request fails.
+	void requestMessageData(
+		PeerData *peer,
+		MsgId msgId,
+		Fn<void()> done,
+		Fn<void()> fail = nullptr);
 	QString exportDirectMessageLink(
 		not_null<HistoryItem*> item,
 		bool inRepliesContext);
@@ -396,7 +401,11 @@ public:
 
 private:
 	struct MessageDataRequest {
-		using Callbacks = std::vector<Fn<void()>>;
+		struct Callback {
+			Fn<void()> done;
+			Fn<void()> fail;
+		};
+		using Callbacks = std::vector<Callback>;
 
 		mtpRequestId requestId = 0;
 		Callbacks callbacks;
@@ -438,7 +447,8 @@ private:
 	void resolveMessageDatas();
 	void finalizeMessageDataRequest(
 		ChannelData *channel,
-		mtpRequestId requestId);
+		mtpRequestId requestId,
+		bool failed = false);
 
 	[[nodiscard]] QVector<MTPInputMessage> collectMessageIds(
 		const MessageDataRequests &requests);
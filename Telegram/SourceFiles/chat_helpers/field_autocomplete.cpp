@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_peer_values.h"
 #include "data/data_file_origin.h"
 #include "data/data_session.h"
+#include "data/data_changes.h"
 #include "data/stickers/data_stickers.h"
 #include "menu/menu_send.h" // SendMenu::FillSendMenu
 #include "chat_helpers/stickers_lottie.h"
@@ -60,6 +61,90 @@ namespace {
 
 } // namespace
 
+// Prefix index over the name words and usernames of the users that
+// were shown as mention candidates, so that typing doesn't compare
+// the query with every name of every member each time.
+class FieldAutocomplete::MentionsIndex final {
+public:
+	void add(not_null<UserData*> user);
+	void refresh(not_null<UserData*> user);
+	void clear();
+
+	// Sorted list of the users with a word starting with the prefix,
+	// compared case insensitively.
+	[[nodiscard]] std::vector<UserData*> query(const QString &prefix) const;
+
+private:
+	void remove(not_null<UserData*> user);
+
+	std::multimap<QString, not_null<UserData*>> _words;
+	std::unordered_map<UserData*, std::vector<QString>> _users;
+
+};
+
+void FieldAutocomplete::MentionsIndex::add(not_null<UserData*> user) {
+	const auto [i, ok] = _users.emplace(user, std::vector<QString>());
+	if (!ok) {
+		return;
+	}
+	auto &words = i->second;
+	words.reserve(user->nameWords().size() + 1);
+	for (const auto &word : user->nameWords()) {
+		words.push_back(word.toLower());
+	}
+	if (const auto username = PrimaryUsername(user); !username.isEmpty()) {
+		words.push_back(username.toLower());
+	}
+	for (const auto &word : words) {
+		_words.emplace(word, user);
+	}
+}
+
+void FieldAutocomplete::MentionsIndex::refresh(not_null<UserData*> user) {
+	if (_users.contains(user)) {
+		remove(user);
+		add(user);
+	}
+}
+
+void FieldAutocomplete::MentionsIndex::remove(not_null<UserData*> user) {
+	const auto i = _users.find(user);
+	if (i == end(_users)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		auto [from, till] = _words.equal_range(word);
+		while (from != till) {
+			if (from->second == user) {
+				from = _words.erase(from);
+			} else {
+				++from;
+			}
+		}
+	}
+	_users.erase(i);
+}
+
+void FieldAutocomplete::MentionsIndex::clear() {
+	_words.clear();
+	_users.clear();
+}
+
+std::vector<UserData*> FieldAutocomplete::MentionsIndex::query(
+		const QString &prefix) const {
+	const auto lower = prefix.toLower();
+	auto result = std::vector<UserData*>();
+	for (auto i = _words.lower_bound(lower); i != end(_words); ++i) {
+		if (!i->first.startsWith(lower)) {
+			break;
+		}
+		result.push_back(i->second);
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), end(result));
+	return result;
+}
+
 class FieldAutocomplete::Inner final : public Ui::RpWidget {
 public:
 	struct ScrollTo {
@@ -201,9 +286,28 @@ FieldAutocomplete::FieldAutocomplete(
 , _show(std::move(show))
 , _session(&_show->session())
 , _st(stOverride ? *stOverride : st::defaultEmojiPan)
+, _mentionsIndex(std::make_unique<MentionsIndex>())
 , _scroll(this) {
 	hide();
 
+	using UpdateFlag = Data::PeerUpdate::Flag;
+	_session->changes().peerUpdates(
+		UpdateFlag::Name
+		| UpdateFlag::Username
+		| UpdateFlag::Usernames
+		| UpdateFlag::Members
+		| UpdateFlag::Admins
+	) | rpl::start_with_next([=](const Data::PeerUpdate &update) {
+		if (update.flags & (UpdateFlag::Members | UpdateFlag::Admins)) {
+			if (update.peer == _mentionsIndexPeer) {
+				_mentionsIndex->clear();
+				_mentionsIndexFilled = false;
+			}
+		} else if (const auto user = update.peer->asUser()) {
+			_mentionsIndex->refresh(user);
+		}
+	}, lifetime());
+
 	_scroll->setGeometry(rect());
 
 	_inner = _scroll->setOwnedWidget(
@@ -301,6 +405,11 @@ void FieldAutocomplete::showFiltered(
 	_chat = peer->asChat();
 	_user = peer->asUser();
 	_channel = peer->asChannel();
+	if (_mentionsIndexPeer != peer) {
+		_mentionsIndexPeer = peer;
+		_mentionsIndex->clear();
+		_mentionsIndexFilled = false;
+	}
 	if (query.isEmpty()) {
 		_type = Type::Mentions;
 		rowsUpdated(
@@ -440,18 +549,22 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 			}
 			return true;
 		};
+		bool listAllSuggestions = _filter.isEmpty();
+		auto matched = std::vector<UserData*>();
+		if (!listAllSuggestions) {
+			fillMentionsIndex();
+			matched = _mentionsIndex->query(_filter);
+		}
 		auto filterNotPassedByName = [&](UserData *user) -> bool {
-			for (const auto &nameWord : user->nameWords()) {
-				if (nameWord.startsWith(_filter, Qt::CaseInsensitive)) {
-					const auto exactUsername =
-						(PrimaryUsername(user).compare(_filter, Qt::CaseInsensitive) == 0);
-					return exactUsername;
-				}
+			if (!ranges::binary_search(matched, user)) {
+				return true;
 			}
-			return filterNotPassedByUsername(user);
+			const auto exactUsername = !PrimaryUsername(user).compare(
+				_filter,
+				Qt::CaseInsensitive);
+			return exactUsername;
 		};
 
-		bool listAllSuggestions = _filter.isEmpty();
 		if (_addInlineBots) {
 			for (const auto user : cRecentInlineBots()) {
 				if (user->isInaccessible()
@@ -645,6 +758,35 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 	_inner->setRecentInlineBotsInRows(recentInlineBots);
 }
 
+void FieldAutocomplete::fillMentionsIndex() {
+	const auto index = [&](not_null<UserData*> user) {
+		_mentionsIndex->add(user);
+	};
+	if (_chat) {
+		// New authors are added without a members update, the list is
+		// short and already indexed users are skipped by a lookup.
+		ranges::for_each(_chat->lastAuthors, index);
+	}
+	if (_mentionsIndexFilled) {
+		return;
+	}
+	_mentionsIndexFilled = true;
+	if (_chat) {
+		ranges::for_each(_chat->participants, index);
+	} else if (_channel && _channel->isMegagroup()) {
+		if (!_channel->canViewMembers()) {
+			const auto &admins = _channel->mgInfo->admins;
+			for (const auto &[userId, rank] : admins) {
+				if (const auto user = _channel->owner().userLoaded(userId)) {
+					index(user);
+				}
+			}
+		} else {
+			ranges::for_each(_channel->mgInfo->lastParticipants, index);
+		}
+	}
+}
+
 void FieldAutocomplete::rowsUpdated(
 		MentionRows &&mrows,
 		HashtagRows &&hrows,
@@ -140,6 +140,7 @@ protected:
 private:
 	class Inner;
 	friend class Inner;
+	class MentionsIndex;
 	struct StickerSuggestion;
 	struct MentionRow;
 	struct BotCommandRow;
@@ -153,12 +154,16 @@ private:
 	void hideFinish();
 
 	void updateFiltered(bool resetScroll = false);
+	void fillMentionsIndex();
 	void recount(bool resetScroll = false);
 	StickerRows getStickerSuggestions();
 
 	const std::shared_ptr<ChatHelpers::Show> _show;
 	const not_null<Main::Session*> _session;
 	const style::EmojiPan &_st;
+	const std::unique_ptr<MentionsIndex> _mentionsIndex;
+	PeerData *_mentionsIndexPeer = nullptr;
+	bool _mentionsIndexFilled = false;
 	QPixmap _cache;
 	MentionRows _mrows;
 	HashtagRows _hrows;
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_abstract_structure.h"
 #include "data/data_photo.h"
 #include "data/data_document.h"
+#include "data/data_histories.h"
 #include "data/data_session.h"
 #include "data/data_stories.h"
 #include "data/data_user.h"
@@ -921,6 +922,17 @@ void Application::handleAppDeactivated() {
 		session->updates().updateOnline();
 	}
 	Ui::Tooltip::Hide();
+
+	// Pixmaps are prepared again on demand if we're shown once more.
+	Images::ShrinkPixmapCache();
+
+	if (_domain->started()) {
+		for (const auto &[index, account] : _domain->accounts()) {
+			if (account->sessionExists()) {
+				account->session().data().histories().unloadUnderPressure();
+			}
+		}
+	}
 }
 
 rpl::producer<bool> Application::appDeactivatedValue() const {
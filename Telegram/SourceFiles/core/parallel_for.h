@@ -0,0 +1,93 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <crl/crl.h>
+
+namespace Core {
+
+// Calls method(index) for each index in [0, count) by chunks of the
+// given size, the first chunk on the calling thread, the others in
+// crl::async. Returns when all the chunks are done.
+template <typename Method>
+void ParallelFor(int count, int chunk, Method &&method) {
+	Expects(chunk > 0);
+
+	const auto runChunk = [&](int index) {
+		const auto from = index * chunk;
+		const auto till = std::min(from + chunk, count);
+		for (auto i = from; i < till; ++i) {
+			method(i);
+		}
+	};
+	const auto chunks = (count + chunk - 1) / chunk;
+	if (chunks < 2) {
+		runChunk(0);
+		return;
+	}
+	auto done = crl::semaphore();
+	auto left = std::atomic<int>(chunks - 1);
+	for (auto i = 1; i != chunks; ++i) {
+		crl::async([&, i] {
+			runChunk(i);
+			if (--left == 0) {
+				done.release();
+			}
+		});
+	}
+	runChunk(0);
+	done.acquire();
+}
+
+// Same, but all the chunks are done in crl::async and the calling
+// thread doesn't wait for them, done() is called on main after that.
+template <typename Method>
+void ParallelForAsync(
+		int count,
+		int chunk,
+		Method method,
+		FnMut<void()> done) {
+	Expects(chunk > 0);
+
+	struct State {
+		State(Method method, FnMut<void()> done, int left)
+		: method(std::move(method))
+		, done(std::move(done))
+		, left(left) {
+		}
+
+		Method method;
+		FnMut<void()> done;
+		std::atomic<int> left = 0;
+	};
+	const auto chunks = (count + chunk - 1) / chunk;
+	if (!chunks) {
+		crl::on_main(std::move(done));
+		return;
+	}
+	const auto state = std::make_shared<State>(
+		std::move(method),
+		std::move(done),
+		chunks);
+	for (auto i = 0; i != chunks; ++i) {
+		crl::async([=] {
+			const auto from = i * chunk;
+			const auto till = std::min(from + chunk, count);
+			for (auto j = from; j < till; ++j) {
+				state->method(j);
+			}
+			if (--state->left == 0) {
+				crl::on_main([=] {
+					state->done();
+				});
+			}
+		});
+	}
+}
+
+} // namespace Core
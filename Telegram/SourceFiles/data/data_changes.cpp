@@ -10,6 +10,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 
 namespace Data {
+namespace {
+
+constexpr auto kNotifyInterval = crl::time(16);
+constexpr auto kStatisticsInterval = 60 * crl::time(1000);
+
+} // namespace
 
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::updated(
@@ -23,7 +29,7 @@ void Changes::Manager<DataType, UpdateType>::updated(
 			flags |= i->second;
 			_updates.erase(i);
 		}
-		_stream.fire({ data, flags });
+		send(data, flags);
 	} else {
 		_updates[data] |= flags;
 	}
@@ -54,11 +60,36 @@ template <typename DataType, typename UpdateType>
 rpl::producer<UpdateType> Changes::Manager<DataType, UpdateType>::updates(
 		not_null<DataType*> data,
 		Flags flags) const {
-	return _stream.events(
-	) | rpl::filter([=](const UpdateType &update) {
-		const auto [updateData, updateFlags] = update;
-		return (updateData == data) && (updateFlags & flags);
-	});
+	const auto weak = std::weak_ptr<DataStreams>(_dataStreams);
+	return [=](auto consumer) {
+		auto result = rpl::lifetime();
+		const auto streams = weak.lock();
+		if (!streams) {
+			return result;
+		}
+		auto &entry = streams->map[data];
+		if (!entry) {
+			entry = std::make_unique<DataStream>();
+		}
+		const auto raw = entry.get();
+		++raw->consumers;
+		raw->stream.events(
+		) | rpl::filter([=](const UpdateType &update) {
+			return (update.flags & flags);
+		}) | rpl::start_with_next_done([=](const UpdateType &update) {
+			consumer.put_next_copy(update);
+		}, [=] {
+			consumer.put_done();
+		}, result);
+		result.add([=] {
+			if (const auto streams = weak.lock()) {
+				if (!--raw->consumers) {
+					streams->unused.push_back(data);
+				}
+			}
+		});
+		return result;
+	};
 }
 
 template <typename DataType, typename UpdateType>
@@ -81,14 +112,74 @@ void Changes::Manager<DataType, UpdateType>::drop(not_null<DataType*> data) {
 	_updates.remove(data);
 }
 
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::send(
+		not_null<DataType*> data,
+		Flags flags) {
+	++_sent;
+	for (auto i = 0; i != kCount; ++i) {
+		if (flags & static_cast<Flag>(1U << i)) {
+			++_sentByFlag[i];
+		}
+	}
+	++_sending;
+	_stream.fire({ data, flags });
+	const auto &map = _dataStreams->map;
+	const auto i = map.find(data);
+	if (i != end(map)) {
+		++_sentToData;
+		i->second->stream.fire({ data, flags });
+	}
+	--_sending;
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::clearUnusedStreams() {
+	if (_sending) {
+		return;
+	}
+	auto &map = _dataStreams->map;
+	for (const auto data : base::take(_dataStreams->unused)) {
+		const auto i = map.find(data);
+		if (i != end(map) && !i->second->consumers) {
+			map.erase(i);
+		}
+	}
+}
+
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::sendNotifications() {
+	clearUnusedStreams();
 	for (const auto &[data, flags] : base::take(_updates)) {
-		_stream.fire({ data, flags });
+		send(data, flags);
 	}
 }
 
-Changes::Changes(not_null<Main::Session*> session) : _session(session) {
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::logStatistics(
+		const char *name) {
+	if (!_sent) {
+		return;
+	}
+	auto flags = QStringList();
+	for (auto i = 0; i != kCount; ++i) {
+		if (_sentByFlag[i]) {
+			flags.push_back(u"%1:%2"_q.arg(i).arg(_sentByFlag[i]));
+		}
+	}
+	DEBUG_LOG(("Changes Info: %1 updates %2 (%3 to %4 objects), by bit: %5."
+		).arg(name
+		).arg(_sent
+		).arg(_sentToData
+		).arg(_dataStreams->map.size()
+		).arg(flags.join(' ')));
+	_sentByFlag = {};
+	_sent = _sentToData = 0;
+}
+
+Changes::Changes(not_null<Main::Session*> session)
+: _session(session)
+, _notifyTimer([=] { sendNotifications(); }) {
 }
 
 Main::Session &Changes::session() const {
@@ -305,8 +396,17 @@ rpl::producer<StoryUpdate> Changes::realtimeStoryUpdates(
 }
 
 void Changes::scheduleNotifications() {
-	if (!_notify) {
-		_notify = true;
+	if (_notify) {
+		return;
+	}
+	_notify = true;
+
+	// Don't deliver more than once a frame, floods of updates from
+	// the busy chats are gathered together till the next one.
+	const auto wait = _lastNotified + kNotifyInterval - crl::now();
+	if (wait > 0) {
+		_notifyTimer.callOnce(wait);
+	} else {
 		crl::on_main(&session(), [=] {
 			sendNotifications();
 		});
@@ -318,12 +418,31 @@ void Changes::sendNotifications() {
 		return;
 	}
 	_notify = false;
+	_notifyTimer.cancel();
+	_lastNotified = crl::now();
 	_peerChanges.sendNotifications();
 	_historyChanges.sendNotifications();
 	_messageChanges.sendNotifications();
 	_entryChanges.sendNotifications();
 	_topicChanges.sendNotifications();
 	_storyChanges.sendNotifications();
+
+	if (_lastNotified - _lastStatistics >= kStatisticsInterval) {
+		_lastStatistics = _lastNotified;
+		logStatistics();
+	}
+}
+
+void Changes::logStatistics() {
+	if (!Logs::DebugEnabled()) {
+		return;
+	}
+	_peerChanges.logStatistics("peer");
+	_historyChanges.logStatistics("history");
+	_topicChanges.logStatistics("topic");
+	_messageChanges.logStatistics("message");
+	_entryChanges.logStatistics("entry");
+	_storyChanges.logStatistics("story");
 }
 
 } // namespace Data
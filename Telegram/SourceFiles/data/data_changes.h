@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/flags.h"
+#include "base/timer.h"
 
 class History;
 class PeerData;
@@ -361,21 +362,45 @@ private:
 		void drop(not_null<DataType*> data);
 
 		void sendNotifications();
+		void logStatistics(const char *name);
 
 	private:
 		static constexpr auto kCount = details::CountBit<Flag>() + 1;
 
+		// Subscribers to a single object are kept apart from the global
+		// stream, so that they don't filter all the updates of the kind.
+		struct DataStream {
+			rpl::event_stream<UpdateType> stream;
+			int consumers = 0;
+		};
+		struct DataStreams {
+			base::flat_map<
+				not_null<DataType*>,
+				std::unique_ptr<DataStream>> map;
+			std::vector<not_null<DataType*>> unused;
+		};
+
 		void sendRealtimeNotifications(
 			not_null<DataType*> data,
 			Flags flags);
+		void send(not_null<DataType*> data, Flags flags);
+		void clearUnusedStreams();
 
 		std::array<rpl::event_stream<UpdateType>, kCount> _realtimeStreams;
 		base::flat_map<not_null<DataType*>, Flags> _updates;
 		rpl::event_stream<UpdateType> _stream;
+		const std::shared_ptr<DataStreams> _dataStreams
+			= std::make_shared<DataStreams>();
+
+		std::array<int64, kCount> _sentByFlag = { { 0 } };
+		int64 _sent = 0;
+		int64 _sentToData = 0;
+		int _sending = 0;
 
 	};
 
 	void scheduleNotifications();
+	void logStatistics();
 
 	const not_null<Main::Session*> _session;
 
@@ -387,6 +412,9 @@ private:
 	Manager<Dialogs::Entry, EntryUpdate> _entryChanges;
 	Manager<Story, StoryUpdate> _storyChanges;
 
+	base::Timer _notifyTimer;
+	crl::time _lastNotified = 0;
+	crl::time _lastStatistics = 0;
 	bool _notify = false;
 
 };
@@ -10,18 +10,25 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "data/data_channel.h"
 #include "data/data_chat.h"
+#include "data/data_document.h"
+#include "data/data_document_media.h"
 #include "data/data_folder.h"
 #include "data/data_forum.h"
 #include "data/data_forum_topic.h"
+#include "data/data_media_types.h"
+#include "data/data_photo.h"
+#include "data/data_photo_media.h"
 #include "data/data_scheduled_messages.h"
 #include "data/data_user.h"
 #include "base/unixtime.h"
 #include "base/random.h"
 #include "main/main_session.h"
 #include "window/notifications_manager.h"
+#include "window/window_session_controller.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "history/view/history_view_element.h"
+#include "ui/image/image.h"
 #include "core/application.h"
 #include "apiwrap.h"
 
@@ -29,6 +36,45 @@ namespace Data {
 namespace {
 
 constexpr auto kReadRequestTimeout = 3 * crl::time(1000);
+constexpr auto kUnloadCheckInterval = 60 * crl::time(1000);
+constexpr auto kUnloadMinIdle = 10 * 60 * crl::time(1000);
+constexpr auto kUnloadUnderPressureInterval = 60 * crl::time(1000);
+constexpr auto kDefaultUnloadBudget = int64(256 * 1024 * 1024);
+constexpr auto kViewCost = int64(2048);
+
+[[nodiscard]] int64 ImageCost(Image *image) {
+	return image ? (int64(image->width()) * image->height() * 4) : 0;
+}
+
+[[nodiscard]] int64 MediaCost(not_null<HistoryItem*> item) {
+	const auto media = item->media();
+	if (!media) {
+		return 0;
+	} else if (const auto photo = media->photo()) {
+		const auto view = photo->activeMediaView();
+		if (!view) {
+			return 0;
+		}
+		auto images = base::flat_set<Image*>{
+			view->image(PhotoSize::Small),
+			view->image(PhotoSize::Thumbnail),
+			view->image(PhotoSize::Large),
+		};
+		auto result = int64();
+		for (const auto image : images) {
+			result += ImageCost(image);
+		}
+		return result;
+	} else if (const auto document = media->document()) {
+		const auto view = document->activeMediaView();
+		return view
+			? (ImageCost(view->thumbnail())
+				+ ImageCost(view->goodThumbnail())
+				+ view->bytes().size())
+			: 0;
+	}
+	return 0;
+}
 
 } // namespace
 
@@ -57,7 +103,10 @@ MTPInputReplyTo ReplyToForMTP(
 
 Histories::Histories(not_null<Session*> owner)
 : _owner(owner)
-, _readRequestsTimer([=] { sendReadRequests(); }) {
+, _readRequestsTimer([=] { sendReadRequests(); })
+, _unloadTimer([=] { unloadCold(_unloadBudget); })
+, _unloadBudget(kDefaultUnloadBudget) {
+	_unloadTimer.callEach(kUnloadCheckInterval);
 }
 
 Session &Histories::owner() const {
@@ -92,9 +141,131 @@ void Histories::unloadAll() {
 }
 
 void Histories::clearAll() {
+	_lastDisplayed.clear();
 	_map.clear();
 }
 
+int64 Histories::unloadCold(int64 budget) {
+	struct Candidate {
+		crl::time lastDisplayed = 0;
+		int64 cost = 0;
+		not_null<History*> history;
+	};
+	const auto now = crl::now();
+	auto candidates = std::vector<Candidate>();
+	auto total = int64();
+	for (const auto &[peerId, owned] : _map) {
+		const auto history = owned.get();
+		if (history->blocks.empty()) {
+			_lastDisplayed.remove(history);
+			continue;
+		}
+		const auto cost = countLoadedCost(history);
+		total += cost;
+		const auto i = _lastDisplayed.find(history);
+		if (i == end(_lastDisplayed) || displayed(history)) {
+			// Count the idle time since we've noticed it is loaded.
+			_lastDisplayed[history] = now;
+		} else if (now - i->second >= kUnloadMinIdle
+			&& !_states.contains(history)) {
+			candidates.push_back({ i->second, cost, history });
+		}
+	}
+	if (total <= budget) {
+		return 0;
+	}
+	ranges::sort(candidates, ranges::less(), &Candidate::lastDisplayed);
+
+	auto freed = int64();
+	auto unloaded = 0;
+	for (const auto &candidate : candidates) {
+		if (total - freed <= budget) {
+			break;
+		}
+		candidate.history->clear(History::ClearType::Unload);
+		_lastDisplayed.remove(candidate.history);
+		freed += candidate.cost;
+		++unloaded;
+	}
+	if (unloaded) {
+		LOG(("Histories Info: Unloaded %1 histories, "
+			"about %2 of %3 bytes freed, budget %4."
+			).arg(unloaded
+			).arg(freed
+			).arg(total
+			).arg(budget));
+	}
+	return freed;
+}
+
+void Histories::unloadUnderPressure() {
+	const auto now = crl::now();
+	if (_lastUnloadUnderPressure
+		&& now - _lastUnloadUnderPressure < kUnloadUnderPressureInterval) {
+		return;
+	}
+	_lastUnloadUnderPressure = now;
+	unloadCold(_unloadBudget / 4);
+}
+
+void Histories::setUnloadBudget(int64 bytes) {
+	Expects(bytes >= 0);
+
+	_unloadBudget = bytes;
+	unloadCold(_unloadBudget);
+}
+
+void Histories::trackDisplayed(
+		not_null<Window::SessionController*> window) {
+	window->activeChatValue(
+	) | rpl::map([](Dialogs::Key chat) {
+		return chat.history();
+	}) | rpl::combine_previous(
+		static_cast<History*>(nullptr)
+	) | rpl::start_with_next([=](History *was, History *now) {
+		// Both the chat we leave and the one we show were seen just now.
+		markDisplayed(was);
+		markDisplayed(now);
+	}, window->lifetime());
+}
+
+void Histories::markDisplayed(History *history) {
+	if (!history) {
+		return;
+	}
+	const auto now = crl::now();
+	_lastDisplayed[history] = now;
+	if (const auto from = history->migrateFrom()) {
+		_lastDisplayed[from] = now;
+	}
+	if (const auto to = history->migrateToOrMe(); to != history) {
+		_lastDisplayed[to] = now;
+	}
+}
+
+bool Histories::displayed(not_null<History*> history) const {
+	for (const auto &window : session().windows()) {
+		const auto shown = window->activeChatCurrent().history();
+		if (shown
+			&& (shown == history
+				|| shown->migrateFrom() == history
+				|| shown->migrateToOrMe() == history)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int64 Histories::countLoadedCost(not_null<History*> history) const {
+	auto result = int64();
+	for (const auto &block : history->blocks) {
+		for (const auto &view : block->messages) {
+			result += kViewCost + MediaCost(view->data());
+		}
+	}
+	return result;
+}
+
 void Histories::editHistoriesMessages(PeerData* peer, bool isHide) {
 	for (const auto& [peerId, history] : _map) {
 		history->editHistoryMessages(peer, isHide);
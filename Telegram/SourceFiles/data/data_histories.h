@@ -21,6 +21,10 @@ class Error;
 struct Response;
 } // namespace MTP
 
+namespace Window {
+class SessionController;
+} // namespace Window
+
 namespace Data {
 
 class Session;
@@ -52,6 +56,16 @@ public:
 
 	void unloadAll();
 	void clearAll();
+
+	// Unloads the histories that were not shown for the longest time
+	// while the loaded ones take more than the budget.
+	// Returns the approximate count of bytes freed.
+	int64 unloadCold(int64 budget);
+
+	// Called on each app deactivation, scans at most once a minute.
+	void unloadUnderPressure();
+	void setUnloadBudget(int64 bytes);
+	void trackDisplayed(not_null<Window::SessionController*> window);
 	void editHistoriesMessages(PeerData* peer, bool isHide);
 
 	void readInbox(not_null<History*> history);
@@ -202,6 +216,10 @@ private:
 	void sendCreateTopicRequest(not_null<History*> history, MsgId rootId);
 	void cancelDelayedByTopicRequest(int id);
 
+	[[nodiscard]] bool displayed(not_null<History*> history) const;
+	void markDisplayed(History *history);
+	[[nodiscard]] int64 countLoadedCost(not_null<History*> history) const;
+
 	const not_null<Session*> _owner;
 
 	std::unordered_map<PeerId, std::unique_ptr<History>> _map;
@@ -210,6 +228,11 @@ private:
 	int _requestAutoincrement = 0;
 	base::Timer _readRequestsTimer;
 
+	base::flat_map<not_null<History*>, crl::time> _lastDisplayed;
+	base::Timer _unloadTimer;
+	int64 _unloadBudget = 0;
+	crl::time _lastUnloadUnderPressure = 0;
+
 	base::flat_set<not_null<Data::Folder*>> _dialogFolderRequests;
 	base::flat_map<
 		not_null<History*>,
@@ -0,0 +1,134 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_map.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMinCapacity = 16;
+
+[[nodiscard]] uint64 Hash(int64 id) {
+	// Fibonacci hashing, ids often go one by one.
+	return uint64(id) * 0x9E3779B97F4A7C15ULL;
+}
+
+} // namespace
+
+MessagesMap::MessagesMap(MessagesMap &&other) noexcept
+: _ids(base::take(other._ids))
+, _items(base::take(other._items))
+, _capacity(base::take(other._capacity))
+, _size(base::take(other._size)) {
+}
+
+MessagesMap &MessagesMap::operator=(MessagesMap &&other) noexcept {
+	if (this != &other) {
+		_ids = base::take(other._ids);
+		_items = base::take(other._items);
+		_capacity = base::take(other._capacity);
+		_size = base::take(other._size);
+	}
+	return *this;
+}
+
+MessagesMap::~MessagesMap() = default;
+
+int MessagesMap::slotFor(int64 id) const {
+	Expects(_capacity > 0);
+
+	return int((Hash(id) >> 32) & uint64(_capacity - 1));
+}
+
+int MessagesMap::indexOf(int64 id) const {
+	if (!_size) {
+		return -1;
+	}
+	for (auto i = slotFor(id);; i = (i + 1) & (_capacity - 1)) {
+		if (_ids[i] == id) {
+			return i;
+		} else if (!_ids[i]) {
+			return -1;
+		}
+	}
+}
+
+HistoryItem *MessagesMap::find(MsgId id) const {
+	const auto index = indexOf(id.bare);
+	return (index >= 0) ? _items[index] : nullptr;
+}
+
+bool MessagesMap::emplace(MsgId id, not_null<HistoryItem*> item) {
+	Expects(id.bare != 0);
+
+	// Keep the load factor below 3/4.
+	if ((_size + 1) * 4 > _capacity * 3) {
+		rehash(std::max(_capacity * 2, kMinCapacity));
+	}
+	auto i = slotFor(id.bare);
+	for (; _ids[i]; i = (i + 1) & (_capacity - 1)) {
+		if (_ids[i] == id.bare) {
+			return false;
+		}
+	}
+	_ids[i] = id.bare;
+	_items[i] = item;
+	++_size;
+	return true;
+}
+
+bool MessagesMap::erase(MsgId id) {
+	auto hole = indexOf(id.bare);
+	if (hole < 0) {
+		return false;
+	}
+	// Backward shift deletion, no tombstones needed.
+	const auto mask = _capacity - 1;
+	for (auto i = (hole + 1) & mask; _ids[i]; i = (i + 1) & mask) {
+		const auto wanted = slotFor(_ids[i]);
+		if (((i - wanted) & mask) >= ((i - hole) & mask)) {
+			_ids[hole] = _ids[i];
+			_items[hole] = _items[i];
+			hole = i;
+		}
+	}
+	_ids[hole] = 0;
+	_items[hole] = nullptr;
+	if (!--_size) {
+		*this = MessagesMap();
+	} else if (_capacity > kMinCapacity && _size * 8 < _capacity) {
+		rehash(_capacity / 2);
+	}
+	return true;
+}
+
+void MessagesMap::rehash(int capacity) {
+	Expects(!(capacity & (capacity - 1)));
+
+	auto ids = std::make_unique<int64[]>(capacity);
+	auto items = std::make_unique<HistoryItem*[]>(capacity);
+	const auto mask = capacity - 1;
+	for (auto i = 0; i != _capacity; ++i) {
+		if (const auto id = _ids[i]) {
+			auto j = int((Hash(id) >> 32) & uint64(mask));
+			while (ids[j]) {
+				j = (j + 1) & mask;
+			}
+			ids[j] = id;
+			items[j] = _items[i];
+		}
+	}
+	_ids = std::move(ids);
+	_items = std::move(items);
+	_capacity = capacity;
+}
+
+int64 MessagesMap::memoryUsage() const {
+	return int64(_capacity) * (sizeof(int64) + sizeof(HistoryItem*));
+}
+
+} // namespace Data
@@ -0,0 +1,59 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class HistoryItem;
+
+namespace Data {
+
+// Open addressing map from message id to item.
+// Ids and items are kept in two plain arrays, so lookups touch
+// only the ids and there is no allocation for each entry.
+class MessagesMap final {
+public:
+	MessagesMap() = default;
+	MessagesMap(MessagesMap &&other) noexcept;
+	MessagesMap &operator=(MessagesMap &&other) noexcept;
+	~MessagesMap();
+
+	[[nodiscard]] HistoryItem *find(MsgId id) const;
+	bool emplace(MsgId id, not_null<HistoryItem*> item);
+	bool erase(MsgId id);
+
+	[[nodiscard]] int size() const {
+		return _size;
+	}
+	[[nodiscard]] bool empty() const {
+		return !_size;
+	}
+	[[nodiscard]] int64 memoryUsage() const;
+
+	template <typename Callback>
+	void enumerate(Callback &&callback) const {
+		for (auto i = 0; i != _capacity; ++i) {
+			if (_ids[i]) {
+				callback(
+					MsgId(_ids[i]),
+					not_null<HistoryItem*>(_items[i]));
+			}
+		}
+	}
+
+private:
+	[[nodiscard]] int indexOf(int64 id) const;
+	[[nodiscard]] int slotFor(int64 id) const;
+	void rehash(int capacity);
+
+	std::unique_ptr<int64[]> _ids;
+	std::unique_ptr<HistoryItem*[]> _items;
+	int _capacity = 0;
+	int _size = 0;
+
+};
+
+} // namespace Data
@@ -0,0 +1,360 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_search_index.h"
+
+#include "core/parallel_for.h"
+#include "data/data_session.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+#include "storage/storage_account.h"
+#include "ui/text/text_utilities.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMaxIndexedMessages = 20000;
+constexpr auto kMaxWordsPerMessage = 128;
+constexpr auto kSerializeVersion = quint32(1);
+constexpr auto kPrepareInParallelMin = 64;
+constexpr auto kPrepareChunk = 32;
+
+struct Stored {
+	FullMsgId id;
+	TimeId date = 0;
+	QStringList words;
+};
+
+[[nodiscard]] QByteArray Serialize(const std::vector<Stored> &list) {
+	auto result = QByteArray();
+	if (list.empty()) {
+		return result;
+	}
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << kSerializeVersion << quint32(list.size());
+		for (const auto &entry : list) {
+			stream
+				<< SerializePeerId(entry.id.peer)
+				<< qint64(entry.id.msg.bare)
+				<< qint32(entry.date)
+				<< entry.words.join(' ');
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(not_null<Session*> owner)
+: _owner(owner) {
+	restore(_owner->session().local().readSearchIndex());
+}
+
+SearchIndex::~SearchIndex() {
+	if (_unsaved) {
+		// Pass the last state, it will be written when the account dies.
+		_owner->session().local().updateSearchIndex([data = snapshot()] {
+			return data;
+		});
+	}
+}
+
+void SearchIndex::add(not_null<HistoryItem*> item) {
+	if (!item->isRegular() || item->isService()) {
+		return;
+	}
+	const auto id = item->fullId();
+	if (_pending.contains(id)) {
+		// Will be added when the words are prepared.
+		return;
+	}
+	addWords(item, PrepareWords(item->originalText().text));
+}
+
+void SearchIndex::addWords(
+		not_null<HistoryItem*> item,
+		QStringList words) {
+	const auto id = item->fullId();
+	const auto i = _entries.find(id);
+	if (i != end(_entries)) {
+		if (i->second.words == words) {
+			return;
+		}
+		erase(i);
+	}
+	if (!words.isEmpty()) {
+		insert(id, item->date(), std::move(words));
+	}
+	changed();
+}
+
+void SearchIndex::remove(not_null<HistoryItem*> item) {
+	remove(item->fullId());
+}
+
+void SearchIndex::remove(FullMsgId id) {
+	const auto i = _entries.find(id);
+	if (i != end(_entries)) {
+		erase(i);
+		changed();
+	}
+}
+
+void SearchIndex::removeNonChannel(MsgId msgId) {
+	// Non-channel message ids are unique, check each indexed peer.
+	auto i = begin(_entries);
+	while (i != end(_entries)) {
+		const auto peerId = i->first.peer;
+		if (!peerIsChannel(peerId)) {
+			const auto j = _entries.find(FullMsgId(peerId, msgId));
+			if (j != end(_entries)) {
+				erase(j);
+				changed();
+				return;
+			}
+		}
+		i = _entries.upper_bound(
+			FullMsgId(peerId, std::numeric_limits<MsgId>::max()));
+	}
+}
+
+void SearchIndex::edited(FullMsgId id, const QString &text) {
+	const auto i = _entries.find(id);
+	if (i == end(_entries)) {
+		return;
+	}
+	auto words = PrepareWords(text);
+	if (i->second.words == words) {
+		return;
+	}
+	const auto date = i->second.date;
+	erase(i);
+	if (!words.isEmpty()) {
+		insert(id, date, std::move(words));
+	}
+	changed();
+}
+
+void SearchIndex::removePeer(PeerId peerId) {
+	auto i = _entries.lower_bound(FullMsgId(peerId, MsgId()));
+	const auto was = _entries.size();
+	while (i != end(_entries) && i->first.peer == peerId) {
+		erase(i++);
+	}
+	if (_entries.size() != was) {
+		changed();
+	}
+}
+
+QStringList SearchIndex::PrepareWords(const QString &text) {
+	auto result = TextUtilities::PrepareSearchWords(text);
+	result.removeDuplicates();
+	if (result.size() > kMaxWordsPerMessage) {
+		result.erase(result.begin() + kMaxWordsPerMessage, result.end());
+	}
+	return result;
+}
+
+void SearchIndex::prepare(const QVector<MTPMessage> &messages) {
+	auto list = std::vector<Prepared>();
+	for (const auto &message : messages) {
+		message.match([&](const MTPDmessage &data) {
+			if (!data.vmessage().v.isEmpty()) {
+				list.push_back({
+					.id = FullMsgId(
+						peerFromMTP(data.vpeer_id()),
+						data.vid().v),
+					.utf8 = data.vmessage().v,
+				});
+			}
+		}, [](const auto &) {});
+	}
+	const auto count = int(list.size());
+	if (count < kPrepareInParallelMin) {
+		return;
+	}
+	for (const auto &entry : list) {
+		_pending.emplace(entry.id);
+	}
+	const auto shared = std::make_shared<std::vector<Prepared>>(
+		std::move(list));
+	Core::ParallelForAsync(count, kPrepareChunk, [=](int index) {
+		auto &entry = (*shared)[index];
+		entry.text = QString::fromUtf8(entry.utf8);
+		entry.words = PrepareWords(entry.text);
+	}, crl::guard(this, [=] {
+		prepared(std::move(*shared));
+	}));
+}
+
+void SearchIndex::prepared(std::vector<Prepared> &&list) {
+	for (auto &entry : list) {
+		if (!_pending.remove(entry.id)) {
+			continue;
+		}
+		const auto item = _owner->message(entry.id);
+		if (!item) {
+			continue;
+		} else if (item->originalText().text == entry.text) {
+			if (item->isRegular() && !item->isService()) {
+				addWords(item, std::move(entry.words));
+			}
+		} else {
+			add(item);
+		}
+	}
+}
+
+std::vector<FullMsgId> SearchIndex::query(
+		PeerId peerId,
+		const QString &query,
+		int limit) const {
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty() || limit <= 0) {
+		return {};
+	}
+	auto found = std::optional<std::vector<FullMsgId>>();
+	for (const auto &word : words) {
+		auto matched = std::vector<FullMsgId>();
+		for (auto i = _words.lower_bound(word); i != end(_words); ++i) {
+			if (!i->first.startsWith(word)) {
+				break;
+			}
+			for (const auto &id : i->second) {
+				if (!peerId || id.peer == peerId) {
+					matched.push_back(id);
+				}
+			}
+		}
+		ranges::sort(matched);
+		matched.erase(ranges::unique(matched), end(matched));
+		if (found) {
+			auto both = std::vector<FullMsgId>();
+			both.reserve(std::min(found->size(), matched.size()));
+			ranges::set_intersection(
+				*found,
+				matched,
+				std::back_inserter(both));
+			found = std::move(both);
+		} else {
+			found = std::move(matched);
+		}
+		if (found->empty()) {
+			return {};
+		}
+	}
+	auto sorted = std::vector<std::pair<TimeId, FullMsgId>>();
+	sorted.reserve(found->size());
+	for (const auto &id : *found) {
+		sorted.emplace_back(_entries.find(id)->second.date, id);
+	}
+	ranges::sort(sorted, ranges::greater());
+	if (int(sorted.size()) > limit) {
+		sorted.resize(limit);
+	}
+	return sorted | ranges::views::transform(
+		&std::pair<TimeId, FullMsgId>::second
+	) | ranges::to_vector;
+}
+
+void SearchIndex::insert(FullMsgId id, TimeId date, QStringList words) {
+	if (int(_entries.size()) >= kMaxIndexedMessages) {
+		const auto oldest = begin(_byDate);
+		if (oldest->first > date) {
+			return;
+		}
+		erase(_entries.find(oldest->second));
+	}
+	for (const auto &word : words) {
+		_words[word].emplace(id);
+	}
+	_byDate.emplace(date, id);
+	_entries.emplace(id, Entry{ date, std::move(words) });
+}
+
+void SearchIndex::erase(std::map<FullMsgId, Entry>::iterator i) {
+	const auto id = i->first;
+	for (const auto &word : i->second.words) {
+		const auto j = _words.find(word);
+		if (j != end(_words)) {
+			j->second.remove(id);
+			if (j->second.empty()) {
+				_words.erase(j);
+			}
+		}
+	}
+	_byDate.erase({ i->second.date, id });
+	_entries.erase(i);
+}
+
+void SearchIndex::restore(const QByteArray &serialized) {
+	if (serialized.isEmpty()) {
+		return;
+	}
+	auto stream = QDataStream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto version = quint32();
+	auto count = quint32();
+	stream >> version >> count;
+	if (stream.status() != QDataStream::Ok
+		|| version != kSerializeVersion
+		|| count > kMaxIndexedMessages) {
+		return;
+	}
+	for (auto i = quint32(); i != count; ++i) {
+		auto peer = quint64();
+		auto msg = qint64();
+		auto date = qint32();
+		auto text = QString();
+		stream >> peer >> msg >> date >> text;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Search Index Error: Could not restore, got %1 of %2."
+				).arg(i
+				).arg(count));
+			return;
+		}
+		insert(
+			FullMsgId(DeserializePeerId(peer), MsgId(msg)),
+			date,
+			text.split(' ', Qt::SkipEmptyParts));
+	}
+	DEBUG_LOG(("Search Index: Restored %1 messages, %2 words."
+		).arg(_entries.size()
+		).arg(_words.size()));
+}
+
+void SearchIndex::changed() {
+	_unsaved = true;
+	const auto session = &_owner->session();
+	const auto weak = base::make_weak(session);
+	session->local().updateSearchIndex([=]() -> Fn<QByteArray()> {
+		if (!weak) {
+			return nullptr;
+		}
+		return snapshot();
+	});
+}
+
+Fn<QByteArray()> SearchIndex::snapshot() const {
+	_unsaved = false;
+
+	// The words lists are shared, the serialization is done off main.
+	auto list = std::vector<Stored>();
+	list.reserve(_entries.size());
+	for (const auto &[id, entry] : _entries) {
+		list.push_back({ id, entry.date, entry.words });
+	}
+	return [list = std::make_shared<const std::vector<Stored>>(
+			std::move(list))] {
+		return Serialize(*list);
+	};
+}
+
+} // namespace Data
@@ -0,0 +1,79 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+
+class HistoryItem;
+
+namespace Data {
+
+class Session;
+
+// Inverted index over the texts of the messages we've seen.
+// It is kept in the local storage and allows to show the search
+// results before (or without) the server response.
+class SearchIndex final : public base::has_weak_ptr {
+public:
+	explicit SearchIndex(not_null<Session*> owner);
+	~SearchIndex();
+
+	void add(not_null<HistoryItem*> item);
+	void remove(not_null<HistoryItem*> item);
+	void remove(FullMsgId id);
+	void removeNonChannel(MsgId msgId);
+	void removePeer(PeerId peerId);
+
+	// Updates the text of an indexed message that is not loaded.
+	void edited(FullMsgId id, const QString &text);
+
+	// Splits the texts of a big slice on worker threads, the messages
+	// are indexed on main when all of them are ready.
+	void prepare(const QVector<MTPMessage> &messages);
+
+	// Empty peerId searches in all the indexed chats.
+	// Results are sorted from the newest to the oldest.
+	[[nodiscard]] std::vector<FullMsgId> query(
+		PeerId peerId,
+		const QString &query,
+		int limit) const;
+
+private:
+	struct Entry {
+		TimeId date = 0;
+		QStringList words;
+	};
+	struct Prepared {
+		FullMsgId id;
+		QByteArray utf8;
+		QString text;
+		QStringList words;
+	};
+
+	[[nodiscard]] static QStringList PrepareWords(const QString &text);
+
+	void addWords(not_null<HistoryItem*> item, QStringList words);
+	void prepared(std::vector<Prepared> &&list);
+	void insert(FullMsgId id, TimeId date, QStringList words);
+	void erase(std::map<FullMsgId, Entry>::iterator i);
+	void restore(const QByteArray &serialized);
+	void changed();
+	[[nodiscard]] Fn<QByteArray()> snapshot() const;
+
+	const not_null<Session*> _owner;
+
+	std::map<FullMsgId, Entry> _entries;
+	std::set<std::pair<TimeId, FullMsgId>> _byDate;
+	std::map<QString, base::flat_set<FullMsgId>> _words;
+	base::flat_set<FullMsgId> _pending;
+
+	mutable bool _unsaved = false;
+
+};
+
+} // namespace Data
@@ -71,6 +71,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_streaming.h"
 #include "data/data_media_rotation.h"
 #include "data/data_histories.h"
+#include "data/data_search_index.h"
 #include "data/data_peer_values.h"
 #include "data/data_premium_limits.h"
 #include "data/data_forum.h"
@@ -269,7 +270,8 @@ Session::Session(not_null<Main::Session*> session)
 , _forumIcons(std::make_unique<ForumIcons>(this))
 , _notifySettings(std::make_unique<NotifySettings>(this))
 , _customEmojiManager(std::make_unique<CustomEmojiManager>(this))
-, _stories(std::make_unique<Stories>(this)) {
+, _stories(std::make_unique<Stories>(this))
+, _searchIndex(std::make_unique<SearchIndex>(this)) {
 	_cache->open(_session->local().cacheKey());
 	_bigFileCache->open(_session->local().cacheBigFileKey());
 
@@ -382,6 +384,16 @@ void Session::clear() {
 	_scheduledMessages = nullptr;
 	_sponsoredMessages = nullptr;
 	_dependentMessages.clear();
+	if (Logs::DebugEnabled()) {
+		const auto usage = memoryUsage();
+		DEBUG_LOG(("Data Info: Clearing %1 messages taking %2 bytes, "
+			"%3 bytes in index, %4 media objects taking %5 bytes."
+			).arg(usage.messages
+			).arg(usage.messagesBytes
+			).arg(usage.indexBytes
+			).arg(usage.photos + usage.documents + usage.webpages
+			).arg(usage.mediaBytes));
+	}
 	base::take(_messages);
 	base::take(_nonChannelMessages);
 	_messageByRandomId.clear();
@@ -1615,19 +1627,17 @@ rpl::producer<not_null<HistoryItem*>> Session::newItemAdded() const {
 
 HistoryItem *Session::changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId) {
 	const auto list = messagesListForInsert(peerId);
-	const auto i = list->find(wasId);
-	if (i == list->end()) {
+	const auto item = list->find(wasId);
+	if (!item) {
 		return nullptr;
 	}
-	const auto item = i->second;
-	list->erase(i);
-	const auto [j, ok] = list->emplace(nowId, item);
+	list->erase(wasId);
+	const auto ok = list->emplace(nowId, item);
 
 	if (!peerIsChannel(peerId)) {
 		if (IsServerMsgId(wasId)) {
-			const auto k = _nonChannelMessages.find(wasId);
-			Assert(k != end(_nonChannelMessages));
-			_nonChannelMessages.erase(k);
+			const auto removed = _nonChannelMessages.erase(wasId);
+			Assert(removed);
 		}
 		if (IsServerMsgId(nowId)) {
 			_nonChannelMessages.emplace(nowId, item);
@@ -1665,6 +1675,7 @@ void Session::notifyItemIdChange(IdChange event) {
 	_itemIdChanges.fire_copy(event);
 
 	if (item) {
+		_searchIndex->add(item);
 		const auto refreshViewDataId = [](not_null<ViewElement*> view) {
 			view->refreshDataId();
 		};
@@ -2216,6 +2227,12 @@ void Session::updateEditedMessage(const MTPMessage &data) {
 	});
 	if (!existing) {
 		Reactions::CheckUnknownForUnread(this, data);
+		if (data.type() == mtpc_message) {
+			const auto &fields = data.c_message();
+			_searchIndex->edited(
+				FullMsgId(peerFromMTP(fields.vpeer_id()), fields.vid().v),
+				qs(fields.vmessage()));
+		}
 		return;
 	}
 	if (existing->isLocalUpdateMedia() && data.type() == mtpc_message) {
@@ -2246,6 +2263,7 @@ void Session::processMessages(
 		const auto id = IdFromMessage(message); // Only 32 bit values here.
 		indices.emplace((uint64(uint32(id.bare)) << 32) | uint64(i), i);
 	}
+	_searchIndex->prepare(data);
 	for (const auto &[position, index] : indices) {
 		addNewMessage(
 			data[index],
@@ -2295,10 +2313,9 @@ void Session::registerMessage(not_null<HistoryItem*> item) {
 	const auto peerId = item->history()->peer->id;
 	const auto list = messagesListForInsert(peerId);
 	const auto itemId = item->id;
-	const auto i = list->find(itemId);
-	if (i != list->end()) {
+	if (const auto existing = list->find(itemId)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		existing->destroy();
 	}
 	list->emplace(itemId, item);
 
@@ -2361,6 +2378,9 @@ void Session::checkTTLs() {
 void Session::processMessagesDeleted(
 		PeerId peerId,
 		const QVector<MTPint> &data) {
+	for (const auto &messageId : data) {
+		_searchIndex->remove(FullMsgId(peerId, messageId.v));
+	}
 	const auto list = messagesList(peerId);
 	const auto affected = historyLoaded(peerId);
 	if (!list && !affected) {
@@ -2369,10 +2389,9 @@ void Session::processMessagesDeleted(
 
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto &messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			i->second->destroy();
+		if (const auto item = list ? list->find(messageId.v) : nullptr) {
+			const auto history = item->history();
+			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -2388,6 +2407,7 @@ void Session::processMessagesDeleted(
 void Session::processNonChannelMessagesDeleted(const QVector<MTPint> &data) {
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto &messageId : data) {
+		_searchIndex->removeNonChannel(messageId.v);
 		if (const auto item = nonChannelMessage(messageId.v)) {
 			const auto history = item->history();
 			item->destroy();
@@ -2466,8 +2486,7 @@ HistoryItem *Session::message(PeerId peerId, MsgId itemId) const {
 		return nullptr;
 	}
 
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return data->find(itemId);
 }
 
 HistoryItem *Session::message(
@@ -2484,8 +2503,7 @@ HistoryItem *Session::nonChannelMessage(MsgId itemId) const {
 	if (!IsServerMsgId(itemId)) {
 		return nullptr;
 	}
-	const auto i = _nonChannelMessages.find(itemId);
-	return (i != end(_nonChannelMessages)) ? i->second.get() : nullptr;
+	return _nonChannelMessages.find(itemId);
 }
 
 void Session::updateDependentMessages(not_null<HistoryItem*> item) {
@@ -4484,4 +4502,24 @@ void Session::clearLocalStorage() {
 	_bigFileCache->clear();
 }
 
+SessionMemoryUsage Session::memoryUsage() const {
+	auto result = SessionMemoryUsage();
+	for (const auto &[peerId, messages] : _messages) {
+		result.messages += messages.size();
+		result.indexBytes += messages.memoryUsage();
+		messages.enumerate([&](MsgId, not_null<HistoryItem*> item) {
+			result.messagesBytes += sizeof(HistoryItem)
+				+ item->originalText().text.capacity() * sizeof(QChar);
+		});
+	}
+	result.indexBytes += _nonChannelMessages.memoryUsage();
+	result.photos = int(_photos.size());
+	result.documents = int(_documents.size());
+	result.webpages = int(_webpages.size());
+	result.mediaBytes = result.photos * int64(sizeof(PhotoData))
+		+ result.documents * int64(sizeof(DocumentData))
+		+ result.webpages * int64(sizeof(WebPageData));
+	return result;
+}
+
 } // namespace Data
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
 #include "data/data_cloud_file.h"
+#include "data/data_messages_map.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
 #include "base/flags.h"
@@ -64,6 +65,17 @@ class GroupCall;
 class NotifySettings;
 class CustomEmojiManager;
 class Stories;
+class SearchIndex;
+
+struct SessionMemoryUsage {
+	int messages = 0;
+	int64 messagesBytes = 0;
+	int64 indexBytes = 0;
+	int photos = 0;
+	int documents = 0;
+	int webpages = 0;
+	int64 mediaBytes = 0;
+};
 
 struct RepliesReadTillUpdate {
 	FullMsgId id;
@@ -140,6 +152,9 @@ public:
 	[[nodiscard]] Stories &stories() const {
 		return *_stories;
 	}
+	[[nodiscard]] SearchIndex &searchIndex() const {
+		return *_searchIndex;
+	}
 
 	[[nodiscard]] MsgId nextNonHistoryEntryId() {
 		return ++_nonHistoryEntryId;
@@ -723,8 +738,10 @@ public:
 
 	void clearLocalStorage();
 
+	[[nodiscard]] SessionMemoryUsage memoryUsage() const;
+
 private:
-	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
+	using Messages = MessagesMap;
 
 	void suggestStartExport();
 
@@ -898,7 +915,7 @@ private:
 	std::map<TimeId, base::flat_set<not_null<HistoryItem*>>> _ttlMessages;
 	base::Timer _ttlCheckTimer;
 
-	std::unordered_map<MsgId, not_null<HistoryItem*>> _nonChannelMessages;
+	MessagesMap _nonChannelMessages;
 
 	base::flat_map<uint64, FullMsgId> _messageByRandomId;
 	base::flat_map<uint64, SentData> _sentMessagesData;
@@ -1019,6 +1036,7 @@ private:
 	const std::unique_ptr<NotifySettings> _notifySettings;
 	const std::unique_ptr<CustomEmojiManager> _customEmojiManager;
 	const std::unique_ptr<Stories> _stories;
+	const std::unique_ptr<SearchIndex> _searchIndex;
 
 	MsgId _nonHistoryEntryId = ServerMaxMsgId.bare + ScheduledMsgIdsRange;
 
@@ -19,6 +19,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_scheduled_messages.h"
 #include "data/data_session.h"
 #include "core/crash_reports.h"
+#include "base/weak_ptr.h"
 
 namespace {
 
@@ -122,8 +123,43 @@ rpl::producer<SparseIdsSlice> SharedMediaViewer(
 		builder->insufficientAround(
 		) | rpl::start_with_next(requestMediaAround, lifetime);
 
+		// Ids restored from the local storage may have no loaded items.
+		const auto requested = lifetime.make_state<base::flat_set<MsgId>>();
+		const auto guard = lifetime.make_state<base::has_weak_ptr>();
+		const auto requestMissing = [=](const SparseIdsSlice &slice) {
+			const auto peer = session->data().peer(key.peerId);
+			for (auto i = 0, count = slice.size(); i != count; ++i) {
+				const auto id = slice[i];
+				if (session->data().message(peer, id)
+					|| !requested->emplace(id).second) {
+					continue;
+				}
+				const auto done = [=] {
+					// Deleted while we were offline, forget about it.
+					if (!session->data().message(peer, id)) {
+						session->storage().remove(
+							Storage::SharedMediaRemoveOne(
+								key.peerId,
+								Storage::SharedMediaTypesMask::All(),
+								id));
+					}
+					consumer.put_next(builder->snapshot());
+				};
+				const auto fail = [=] {
+					// Try again with the next snapshot.
+					requested->remove(id);
+				};
+				session->api().requestMessageData(
+					peer,
+					id,
+					crl::guard(guard, done),
+					crl::guard(guard, fail));
+			}
+		};
 		auto pushNextSnapshot = [=] {
-			consumer.put_next(builder->snapshot());
+			auto snapshot = builder->snapshot();
+			requestMissing(snapshot);
+			consumer.put_next(std::move(snapshot));
 		};
 
 		using SliceUpdate = Storage::SharedMediaSliceUpdate;
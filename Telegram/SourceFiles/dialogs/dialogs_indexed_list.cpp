@@ -12,6 +12,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 
 namespace Dialogs {
+namespace {
+
+constexpr auto kMinPrefixLength = 2;
+constexpr auto kMaxPrefixLength = 3;
+
+} // namespace
 
 IndexedList::IndexedList(SortMode sortMode, FilterId filterId)
 : _sortMode(sortMode)
@@ -33,6 +39,7 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 		}
 		result.letters.emplace(ch, j->second.addToEnd(key));
 	}
+	indexPrefixes(key);
 	return result;
 }
 
@@ -49,6 +56,7 @@ Row *IndexedList::addByName(Key key) {
 		}
 		j->second.addByName(key);
 	}
+	indexPrefixes(key);
 	return result;
 }
 
@@ -127,6 +135,9 @@ void IndexedList::adjustByName(
 	const auto mainRow = _list.adjustByName(key);
 	if (!mainRow) return;
 
+	unindexPrefixes(key);
+	indexPrefixes(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
@@ -164,6 +175,9 @@ void IndexedList::adjustNames(
 	auto mainRow = _list.getRow(key);
 	if (!mainRow) return;
 
+	unindexPrefixes(key);
+	indexPrefixes(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto &ch : key.entry()->chatListFirstLetters()) {
@@ -201,12 +215,57 @@ void IndexedList::remove(Key key, Row *replacedBy) {
 				it->second.remove(key, replacedBy);
 			}
 		}
+		unindexPrefixes(key);
 	}
 }
 
 void IndexedList::clear() {
 	_list.clear();
 	_index.clear();
+	_prefixes.clear();
+	_prefixesByKey.clear();
+}
+
+void IndexedList::indexPrefixes(Key key) {
+	auto prefixes = std::vector<QString>();
+	for (const auto &word : key.entry()->chatListNameWords()) {
+		const auto till = std::min(int(word.size()), kMaxPrefixLength);
+		for (auto length = kMinPrefixLength; length <= till; ++length) {
+			auto prefix = word.left(length);
+			if (!ranges::contains(prefixes, prefix)) {
+				_prefixes[prefix].emplace(key);
+				prefixes.push_back(std::move(prefix));
+			}
+		}
+	}
+	if (!prefixes.empty()) {
+		_prefixesByKey.emplace(key, std::move(prefixes));
+	}
+}
+
+void IndexedList::unindexPrefixes(Key key) {
+	const auto i = _prefixesByKey.find(key);
+	if (i == end(_prefixesByKey)) {
+		return;
+	}
+	for (const auto &prefix : i->second) {
+		const auto j = _prefixes.find(prefix);
+		if (j != end(_prefixes)) {
+			j->second.remove(key);
+			if (j->second.empty()) {
+				_prefixes.erase(j);
+			}
+		}
+	}
+	_prefixesByKey.erase(i);
+}
+
+const base::flat_set<Key> *IndexedList::filteredByPrefix(
+		const QString &word) const {
+	Expects(word.size() >= kMinPrefixLength);
+
+	const auto i = _prefixes.find(word.left(kMaxPrefixLength));
+	return (i != end(_prefixes)) ? &i->second : nullptr;
 }
 
 std::vector<not_null<Row*>> IndexedList::filtered(
@@ -233,8 +292,22 @@ std::vector<not_null<Row*>> IndexedList::filtered(
 	if (!minimal || minimal->empty()) {
 		return result;
 	}
-	result.reserve(minimal->size());
-	for (const auto &row : *minimal) {
+	const auto candidates = [&]() -> const base::flat_set<Key>* {
+		auto result = (const base::flat_set<Key>*)nullptr;
+		for (const auto &word : words) {
+			if (word.size() < kMinPrefixLength) {
+				continue;
+			}
+			const auto found = filteredByPrefix(word);
+			if (!found) {
+				return found;
+			} else if (!result || result->size() > found->size()) {
+				result = found;
+			}
+		}
+		return result;
+	}();
+	const auto allFound = [&](not_null<Row*> row) {
 		const auto &nameWords = row->entry()->chatListNameWords();
 		const auto found = [&](const QString &word) {
 			for (const auto &name : nameWords) {
@@ -244,15 +317,35 @@ std::vector<not_null<Row*>> IndexedList::filtered(
 			}
 			return false;
 		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
+		for (const auto &word : words) {
+			if (!found(word)) {
+				return false;
+			}
+		}
+		return true;
+	};
+	const auto prefixesTyped = ranges::any_of(words, [](const QString &w) {
+		return w.size() >= kMinPrefixLength;
+	});
+	if (prefixesTyped && !candidates) {
+		return result;
+	} else if (candidates && candidates->size() < minimal->size()) {
+		result.reserve(candidates->size());
+		for (const auto &key : *candidates) {
+			if (const auto row = minimal->getRow(key)) {
+				if (allFound(row)) {
+					result.push_back(row);
 				}
 			}
-			return true;
-		}();
-		if (allFound) {
+		}
+		ranges::sort(result, ranges::less(), [](not_null<Row*> row) {
+			return row->index();
+		});
+		return result;
+	}
+	result.reserve(minimal->size());
+	for (const auto &row : *minimal) {
+		if (allFound(row)) {
 			result.push_back(row);
 		}
 	}
@@ -91,11 +91,22 @@ private:
 		not_null<History*> history,
 		const base::flat_set<QChar> &oldChars);
 
+	void indexPrefixes(Key key);
+	void unindexPrefixes(Key key);
+	[[nodiscard]] const base::flat_set<Key> *filteredByPrefix(
+		const QString &word) const;
+
 	SortMode _sortMode = SortMode();
 	FilterId _filterId = 0;
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	// Name words prefixes of two and more characters, so that typing
+	// in the search field narrows the candidates before the first
+	// letter bucket does it.
+	std::map<QString, base::flat_set<Key>> _prefixes;
+	std::map<Key, std::vector<QString>> _prefixesByKey;
+
 };
 
 } // namespace Dialogs
@@ -64,6 +64,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_forum.h"
 #include "data/data_forum_topic.h"
 #include "data/data_histories.h"
+#include "data/data_search_index.h"
 #include "data/data_changes.h"
 #include "data/data_download_manager.h"
 #include "data/data_chat_filters.h"
@@ -1827,6 +1828,7 @@ bool Widget::searchMessages(bool searchCache) {
 			}).send();
 			_searchQueries.emplace(_searchRequest, _searchQuery);
 		}
+		searchLocal();
 	}
 	const auto query = Api::ConvertPeerSearchQuery(q);
 	if (searchForPeersRequired(query)) {
@@ -2125,6 +2127,45 @@ void Widget::searchMore() {
 	}
 }
 
+void Widget::searchLocal() {
+	if (_searchQueryFrom) {
+		return;
+	}
+	const auto peer = searchInPeer();
+	const auto topic = searchInTopic();
+	const auto skipArchive = !peer
+		&& session().settings().skipArchiveInSearch();
+	const auto ids = session().data().searchIndex().query(
+		peer ? peer->id : PeerId(),
+		_searchQuery,
+		kSearchPerPage);
+	auto items = std::vector<not_null<HistoryItem*>>();
+	for (const auto &id : ids) {
+		const auto item = session().data().message(id);
+		if (!item
+			|| (topic && item->topicRootId() != topic->rootId())
+			|| (skipArchive && item->history()->folder())) {
+			continue;
+		}
+		items.push_back(item);
+	}
+	if (items.empty()) {
+		return;
+	}
+
+	// Server results will replace these as soon as they arrive.
+	const auto count = int(items.size());
+	_inner->searchReceived(
+		std::move(items),
+		nullptr,
+		(peer
+			? SearchRequestType::PeerFromStart
+			: SearchRequestType::FromStart),
+		count);
+	listScrollUpdated();
+	update();
+}
+
 void Widget::searchReceived(
 		SearchRequestType type,
 		const MTPmessages_Messages &result,
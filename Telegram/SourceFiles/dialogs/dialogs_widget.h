@@ -150,6 +150,7 @@ private:
 	[[nodiscard]] QString currentSearchQuery() const;
 	void clearSearchField();
 	bool searchMessages(bool searchCache = false);
+	void searchLocal();
 	void needSearchMessages();
 
 	void slideFinished();
@@ -22,8 +22,8 @@ namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 1024 * 1024;
-constexpr auto kFileRequestsCount = 2;
-//constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileRequestsCount = 4;
+constexpr auto kFilePrefetchCount = 3;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -39,6 +39,9 @@ struct LocationKey {
 	inline bool operator<(const LocationKey &other) const {
 		return std::tie(type, id) < std::tie(other.type, other.id);
 	}
+	inline bool operator==(const LocationKey &other) const {
+		return std::tie(type, id) == std::tie(other.type, other.id);
+	}
 };
 
 LocationKey ComputeLocationKey(const Data::FileLocation &value) {
@@ -87,6 +90,53 @@ Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 	return Settings::Type(0);
 }
 
+[[nodiscard]] Data::File::SkipReason ComputeSkipReason(
+		const Settings &settings,
+		const Data::File &file,
+		const Data::Message *message,
+		const Data::Story *story) {
+	using SkipReason = Data::File::SkipReason;
+	using Type = MediaSettings::Type;
+	const auto media = message
+		? &message->media
+		: story
+		? &story->media
+		: nullptr;
+	const auto type = media ? v::match(media->content, [&](
+			const Data::Document &data) {
+		if (data.isSticker) {
+			return Type::Sticker;
+		} else if (data.isVideoMessage) {
+			return Type::VideoMessage;
+		} else if (data.isVoiceMessage) {
+			return Type::VoiceMessage;
+		} else if (data.isAnimated) {
+			return Type::GIF;
+		} else if (data.isVideoFile) {
+			return Type::Video;
+		} else {
+			return Type::File;
+		}
+	}, [](const auto &data) {
+		return Type::Photo;
+	}) : Type(0);
+
+	const auto fullSize = message
+		? message->file().size
+		: story
+		? story->file().size
+		: file.size;
+	if (message && Data::SkipMessageByDate(*message, settings)) {
+		return SkipReason::DateLimits;
+	} else if (!story && (settings.media.types & type) != type) {
+		return SkipReason::FileType;
+	} else if (!story && fullSize >= settings.media.sizeLimit) {
+		// Don't load thumbs for large files that we skip.
+		return SkipReason::FileSize;
+	}
+	return SkipReason::None;
+}
+
 } // namespace
 
 class ApiWrap::LoadedFileCache {
@@ -96,6 +146,7 @@ public:
 	LoadedFileCache(int limit);
 
 	void save(const Location &location, const QString &relativePath);
+	void save(const LocationKey &key, const QString &relativePath);
 	std::optional<QString> find(const Location &location) const;
 
 private:
@@ -177,9 +228,12 @@ struct ApiWrap::FileProcess {
 	struct Request {
 		int64 offset = 0;
 		QByteArray bytes;
+		mtpRequestId requestId = 0;
 	};
 	std::deque<Request> requests;
-	mtpRequestId requestId = 0;
+	mtpRequestId referenceRequestId = 0;
+
+	[[nodiscard]] Request *request(int64 offset);
 };
 
 struct ApiWrap::FileProgress {
@@ -315,7 +369,12 @@ void ApiWrap::LoadedFileCache::save(
 	if (!location) {
 		return;
 	}
-	const auto key = ComputeLocationKey(location);
+	save(ComputeLocationKey(location), relativePath);
+}
+
+void ApiWrap::LoadedFileCache::save(
+		const LocationKey &key,
+		const QString &relativePath) {
 	_map[key] = relativePath;
 	_list.push_back(key);
 	if (_list.size() > _limit) {
@@ -338,7 +397,12 @@ std::optional<QString> ApiWrap::LoadedFileCache::find(
 }
 
 ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
-: file(path, stats) {
+: file(path, stats, false) {
+}
+
+auto ApiWrap::FileProcess::request(int64 offset) -> Request* {
+	const auto i = ranges::find(requests, offset, &Request::offset);
+	return (i != end(requests)) ? &*i : nullptr;
 }
 
 template <typename Request>
@@ -367,11 +431,11 @@ auto ApiWrap::splitRequest(int index, Request &&request) {
 		std::forward<Request>(request)));
 }
 
-auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
+auto ApiWrap::fileRequest(not_null<FileProcess*> process, int64 offset) {
+	const auto &location = process->location;
 	Expects(location.dcId != 0
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
 	Expects(_takeoutId.has_value());
-	Expects(_fileProcess->requestId == 0);
 
 	return std::move(_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
 		MTP_long(*_takeoutId),
@@ -381,10 +445,13 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 			MTP_long(offset),
 			MTP_int(kFileChunkSize))
 	)).fail([=](const MTP::Error &result) {
-		_fileProcess->requestId = 0;
+		if (const auto request = process->request(offset)) {
+			request->requestId = 0;
+		}
 		if (result.type() == u"TAKEOUT_FILE_EMPTY"_q
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
+				process,
 				0,
 				MTP_upload_file(
 					MTP_storage_filePartial(),
@@ -393,10 +460,10 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 		} else if (result.type() == u"LOCATION_INVALID"_q
 			|| result.type() == u"VERSION_INVALID"_q
 			|| result.type() == u"LOCATION_NOT_AVAILABLE"_q) {
-			filePartUnavailable();
+			filePartUnavailable(process);
 		} else if (result.code() == 400
 			&& result.type().startsWith(u"FILE_REFERENCE_"_q)) {
-			filePartRefreshReference(offset);
+			filePartRefreshReference(process);
 		} else {
 			error(std::move(result));
 		}
@@ -416,6 +483,18 @@ rpl::producer<Output::Result> ApiWrap::ioErrors() const {
 	return _ioErrors.events();
 }
 
+rpl::producer<ApiWrap::LoadedFile> ApiWrap::fileLoaded() const {
+	return _fileLoaded.events();
+}
+
+void ApiWrap::restoreLoadedFiles(const std::vector<LoadedFile> &files) {
+	for (const auto &file : files) {
+		_fileCache->save(
+			LocationKey{ file.locationType, file.locationId },
+			file.relativePath);
+	}
+}
+
 void ApiWrap::startExport(
 		const Settings &settings,
 		Output::Stats *stats,
@@ -1247,9 +1326,7 @@ void ApiWrap::skipFile(uint64 randomId) {
 	}
 	LOG(("Export Info: File skipped."));
 	Assert(!_fileProcess->requests.empty());
-	Assert(_fileProcess->requestId != 0);
-	_mtp.request(base::take(_fileProcess->requestId)).cancel();
-	base::take(_fileProcess)->done(QString());
+	fileProcessFinished(_fileProcess.get(), QString());
 }
 
 void ApiWrap::cancelExportFast() {
@@ -1757,12 +1834,19 @@ Data::Message *ApiWrap::currentFileMessage() const {
 
 Data::FileOrigin ApiWrap::currentFileMessageOrigin() const {
 	Expects(_chatProcess != nullptr);
+
+	return fileMessageOrigin(_chatProcess->fileIndex);
+}
+
+Data::FileOrigin ApiWrap::fileMessageOrigin(int index) const {
+	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
+	Expects(index >= 0 && index < _chatProcess->slice->list.size());
 
 	const auto splitIndex = _chatProcess->info.splits[
 		_chatProcess->localSplitIndex];
 	auto result = Data::FileOrigin();
-	result.messageId = currentFileMessage()->id;
+	result.messageId = _chatProcess->slice->list[index].id;
 	result.split = (splitIndex >= 0)
 		? splitIndex
 		: (int(_splits.size()) + splitIndex);
@@ -1824,6 +1908,7 @@ void ApiWrap::loadNextMessageFile() {
 		if (!messageCustomEmojiReady(message)) {
 			return;
 		}
+		prefetchMessageFiles();
 		const auto fileProgress = [=](FileProgress value) {
 			return loadMessageFileProgress(value);
 		};
@@ -1856,6 +1941,9 @@ void ApiWrap::finishMessagesSlice() {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
 
+	// All the prefetched files were adopted while loading the slice.
+	cancelFilePrefetches();
+
 	auto slice = *base::take(_chatProcess->slice);
 	if (!slice.list.empty()) {
 		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
@@ -1949,6 +2037,8 @@ void ApiWrap::finishMessages() {
 	Expects(_chatProcess != nullptr);
 	Expects(!_chatProcess->slice.has_value());
 
+	cancelFilePrefetches();
+
 	const auto process = base::take(_chatProcess);
 	process->done();
 }
@@ -1972,48 +2062,13 @@ bool ApiWrap::processFileLoad(
 		return !file.relativePath.isEmpty();
 	}
 
-	using Type = MediaSettings::Type;
-	const auto media = message
-		? &message->media
-		: story
-		? &story->media
-		: nullptr;
-	const auto type = media ? v::match(media->content, [&](
-			const Data::Document &data) {
-		if (data.isSticker) {
-			return Type::Sticker;
-		} else if (data.isVideoMessage) {
-			return Type::VideoMessage;
-		} else if (data.isVoiceMessage) {
-			return Type::VoiceMessage;
-		} else if (data.isAnimated) {
-			return Type::GIF;
-		} else if (data.isVideoFile) {
-			return Type::Video;
-		} else {
-			return Type::File;
-		}
-	}, [](const auto &data) {
-		return Type::Photo;
-	}) : Type(0);
-
-	const auto fullSize = message
-		? message->file().size
-		: story
-		? story->file().size
-		: file.size;
-	if (message && Data::SkipMessageByDate(*message, *_settings)) {
-		file.skipReason = SkipReason::DateLimits;
-		return true;
-	} else if (!story && (_settings->media.types & type) != type) {
-		file.skipReason = SkipReason::FileType;
-		return true;
-	} else if (!story && fullSize >= _settings->media.sizeLimit) {
-		// Don't load thumbs for large files that we skip.
-		file.skipReason = SkipReason::FileSize;
+	const auto skipReason = ComputeSkipReason(*_settings, file, message, story);
+	if (skipReason != SkipReason::None) {
+		file.skipReason = skipReason;
 		return true;
+	} else if (!adoptPrefetchedFile(file, progress, done)) {
+		loadFile(file, origin, std::move(progress), std::move(done));
 	}
-	loadFile(file, origin, std::move(progress), std::move(done));
 	return false;
 }
 
@@ -2032,6 +2087,7 @@ bool ApiWrap::writePreloadedFile(
 		if (const auto result = process->file.writeBlock(file.content)) {
 			file.relativePath = process->relativePath;
 			_fileCache->save(file.location, file.relativePath);
+			fileLoadedToDisk(file.location, file.relativePath, process->file);
 		} else {
 			ioError(result);
 		}
@@ -2063,9 +2119,77 @@ void ApiWrap::loadFile(
 		}
 	}
 
-	loadFilePart();
+	startFileProcess(_fileProcess.get());
+}
+
+void ApiWrap::startFileProcess(not_null<FileProcess*> process) {
+	// Create the file right away, so that the files loaded in parallel
+	// won't choose the same name in PrepareRelativePath.
+	if (const auto result = process->file.writeBlock({}); !result) {
+		ioError(result);
+		return;
+	}
+	loadFilePart(process);
+
+	Ensures(!process->requests.empty());
+}
+
+bool ApiWrap::adoptPrefetchedFile(
+		const Data::File &file,
+		Fn<bool(FileProgress)> &progress,
+		FnMut<void(QString)> &done) {
+	Expects(_fileProcess == nullptr);
+
+	const auto key = ComputeLocationKey(file.location);
+	const auto i = ranges::find(_filePrefetches, key, [](const auto &p) {
+		return ComputeLocationKey(p->location);
+	});
+	if (i == end(_filePrefetches)) {
+		return false;
+	}
+	_fileProcess = std::move(*i);
+	_filePrefetches.erase(i);
+	_fileProcess->progress = std::move(progress);
+	_fileProcess->done = std::move(done);
+	if (_fileProcess->progress) {
+		_fileProcess->progress(FileProgress{
+			_fileProcess->file.size(),
+			_fileProcess->size });
+	}
+	return true;
+}
+
+void ApiWrap::prefetchMessageFiles() {
+	Expects(_chatProcess != nullptr);
+	Expects(_chatProcess->slice.has_value());
 
-	Ensures(_fileProcess->requestId != 0);
+	auto &list = _chatProcess->slice->list;
+	for (auto index = _chatProcess->fileIndex + 1
+		; (index < int(list.size())
+			&& int(_filePrefetches.size()) < kFilePrefetchCount)
+		; ++index) {
+		const auto &message = list[index];
+		const auto &file = message.file();
+		if (!file.relativePath.isEmpty()
+			|| file.skipReason != Data::File::SkipReason::None
+			|| !file.location
+			|| !file.content.isEmpty()
+			|| _fileCache->find(file.location)
+			|| (ComputeSkipReason(*_settings, file, &message, nullptr)
+				!= Data::File::SkipReason::None)) {
+			continue;
+		}
+		const auto key = ComputeLocationKey(file.location);
+		const auto same = [&](const std::unique_ptr<FileProcess> &p) {
+			return p && ComputeLocationKey(p->location) == key;
+		};
+		if (same(_fileProcess) || ranges::any_of(_filePrefetches, same)) {
+			continue;
+		}
+		_filePrefetches.push_back(
+			prepareFileProcess(file, fileMessageOrigin(index)));
+		startFileProcess(_filePrefetches.back().get());
+	}
 }
 
 auto ApiWrap::prepareFileProcess(
@@ -2088,43 +2212,39 @@ auto ApiWrap::prepareFileProcess(
 	return result;
 }
 
-void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requestId
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
-		return;
+void ApiWrap::loadFilePart(not_null<FileProcess*> process) {
+	while (!process->referenceRequestId
+		&& process->requests.size() < kFileRequestsCount
+		&& (process->size > 0 || process->requests.empty())
+		&& (process->size <= 0 || process->offset < process->size)) {
+		const auto offset = process->offset;
+		process->requests.push_back({ offset });
+		sendFilePart(process, offset);
+		process->offset += kFileChunkSize;
 	}
+}
+
+void ApiWrap::sendFilePart(not_null<FileProcess*> process, int64 offset) {
+	const auto request = process->request(offset);
+	Assert(request != nullptr);
 
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	_fileProcess->requestId = fileRequest(
-		_fileProcess->location,
-		_fileProcess->offset
+	request->requestId = fileRequest(
+		process,
+		offset
 	).done([=](const MTPupload_File &result) {
-		_fileProcess->requestId = 0;
-		filePartDone(offset, result);
+		filePartDone(process, offset, result);
 	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		// Only one request at a time supported right now.
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
-	}
 }
 
-void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartDone(
+		not_null<FileProcess*> process,
+		int64 offset,
+		const MTPupload_File &result) {
+	Expects(!process->requests.empty());
+
+	const auto request = process->request(offset);
+	Assert(request != nullptr);
+	request->requestId = 0;
 
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		error("Cdn redirect is not supported.");
@@ -2132,27 +2252,20 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 	}
 	const auto &data = result.c_upload_file();
 	if (data.vbytes().v.isEmpty()) {
-		if (_fileProcess->size > 0) {
+		if (process->size > 0) {
 			error("Empty bytes received in file part.");
 			return;
 		}
-		const auto result = _fileProcess->file.writeBlock({});
+		const auto result = process->file.writeBlock({});
 		if (!result) {
 			ioError(result);
 			return;
 		}
 	} else {
-		using Request = FileProcess::Request;
-		auto &requests = _fileProcess->requests;
-		const auto i = ranges::find(
-			requests,
-			offset,
-			[](const Request &request) { return request.offset; });
-		Assert(i != end(requests));
+		request->bytes = data.vbytes().v;
 
-		i->bytes = data.vbytes().v;
-
-		auto &file = _fileProcess->file;
+		auto &requests = process->requests;
+		auto &file = process->file;
 		while (!requests.empty() && !requests.front().bytes.isEmpty()) {
 			const auto &bytes = requests.front().bytes;
 			if (const auto result = file.writeBlock(bytes); !result) {
@@ -2162,42 +2275,119 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 			requests.pop_front();
 		}
 
-		if (_fileProcess->progress) {
-			_fileProcess->progress(FileProgress{
+		if (process->progress) {
+			process->progress(FileProgress{
 				file.size(),
-				_fileProcess->size });
+				process->size });
 		}
 
 		if (!requests.empty()
-			|| !_fileProcess->size
-			|| _fileProcess->size > _fileProcess->offset) {
-			loadFilePart();
+			|| !process->size
+			|| process->size > process->offset) {
+			loadFilePart(process);
 			return;
 		}
 	}
+	fileProcessFinished(process, process->relativePath);
+}
 
-	auto process = base::take(_fileProcess);
-	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
-	process->done(process->relativePath);
+void ApiWrap::fileProcessFinished(
+		not_null<FileProcess*> process,
+		const QString &relativePath) {
+	cancelFileRequests(process);
+
+	// The file was created to reserve its name, remove it if it is empty.
+	const auto reserved = (relativePath.isEmpty() && process->file.empty())
+		? (_settings->path + process->relativePath)
+		: QString();
+	if (!relativePath.isEmpty()) {
+		_fileCache->save(process->location, relativePath);
+		fileLoadedToDisk(process->location, relativePath, process->file);
+		if (_stats) {
+			// Skipped and canceled downloads are not counted.
+			_stats->incrementFiles();
+		}
+	}
+	if (_fileProcess.get() == process) {
+		auto done = std::move(_fileProcess->done);
+		_fileProcess = nullptr;
+		if (!reserved.isEmpty()) {
+			QFile::remove(reserved);
+		}
+		done(relativePath);
+		return;
+	}
+	const auto i = ranges::find(
+		_filePrefetches,
+		process.get(),
+		&std::unique_ptr<FileProcess>::get);
+	Assert(i != end(_filePrefetches));
+	_filePrefetches.erase(i);
+	if (!reserved.isEmpty()) {
+		QFile::remove(reserved);
+	}
+	if (_chatProcess && _chatProcess->slice.has_value()) {
+		prefetchMessageFiles();
+	}
 }
 
-void ApiWrap::filePartRefreshReference(int64 offset) {
-	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+void ApiWrap::fileLoadedToDisk(
+		const Data::FileLocation &location,
+		const QString &relativePath,
+		const Output::File &file) {
+	if (!location) {
+		return;
+	}
+	const auto key = ComputeLocationKey(location);
+	_fileLoaded.fire({
+		.locationType = key.type,
+		.locationId = key.id,
+		.relativePath = relativePath,
+		.size = file.size(),
+	});
+}
 
-	const auto &origin = _fileProcess->origin;
+void ApiWrap::cancelFileRequests(not_null<FileProcess*> process) {
+	const auto cancel = [&](mtpRequestId &requestId) {
+		if (requestId) {
+			_mtp.request(base::take(requestId)).cancel();
+		}
+	};
+	for (auto &request : process->requests) {
+		cancel(request.requestId);
+	}
+	cancel(process->referenceRequestId);
+}
+
+void ApiWrap::cancelFilePrefetches() {
+	auto incomplete = QStringList();
+	for (auto &process : base::take(_filePrefetches)) {
+		cancelFileRequests(process.get());
+		incomplete.push_back(_settings->path + process->relativePath);
+		process = nullptr;
+	}
+	for (const auto &path : incomplete) {
+		QFile::remove(path);
+	}
+}
+
+void ApiWrap::filePartRefreshReference(not_null<FileProcess*> process) {
+	if (process->referenceRequestId) {
+		// The part will be resent when the reference is refreshed.
+		return;
+	}
+	const auto &origin = process->origin;
 	if (origin.storyId) {
-		_fileProcess->requestId = mainRequest(MTPstories_GetStoriesByID(
+		process->referenceRequestId = mainRequest(MTPstories_GetStoriesByID(
 			MTP_inputPeerSelf(),
 			MTP_vector<MTPint>(1, MTP_int(origin.storyId))
 		)).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
-			filePartUnavailable();
+			process->referenceRequestId = 0;
+			filePartUnavailable(process);
 			return true;
 		}).done([=](const MTPstories_Stories &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			process->referenceRequestId = 0;
+			filePartExtractReference(process, result);
 		}).send();
 		return;
 	} else if (!origin.messageId) {
@@ -2214,21 +2404,21 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 				origin.peer.c_inputPeerChannelFromMessage().vpeer(),
 				origin.peer.c_inputPeerChannelFromMessage().vmsg_id(),
 				origin.peer.c_inputPeerChannelFromMessage().vchannel_id());
-		_fileProcess->requestId = mainRequest(MTPchannels_GetMessages(
+		process->referenceRequestId = mainRequest(MTPchannels_GetMessages(
 			channel,
 			MTP_vector<MTPInputMessage>(
 				1,
 				MTP_inputMessageID(MTP_int(origin.messageId)))
 		)).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
-			filePartUnavailable();
+			process->referenceRequestId = 0;
+			filePartUnavailable(process);
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			process->referenceRequestId = 0;
+			filePartExtractReference(process, result);
 		}).send();
 	} else {
-		_fileProcess->requestId = splitRequest(
+		process->referenceRequestId = splitRequest(
 			origin.split,
 			MTPmessages_GetMessages(
 				MTP_vector<MTPInputMessage>(
@@ -2236,21 +2426,20 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 					MTP_inputMessageID(MTP_int(origin.messageId)))
 			)
 		).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
-			filePartUnavailable();
+			process->referenceRequestId = 0;
+			filePartUnavailable(process);
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			process->referenceRequestId = 0;
+			filePartExtractReference(process, result);
 		}).send();
 	}
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
+		not_null<FileProcess*> process,
 		const MTPmessages_Messages &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+	Expects(process->referenceRequestId == 0);
 
 	result.match([&](const MTPDmessages_messagesNotModified &data) {
 		error("Unexpected messagesNotModified received.");
@@ -2266,68 +2455,63 @@ void ApiWrap::filePartExtractReference(
 			data.vchats(),
 			_chatProcess->info.relativePath);
 		for (const auto &message : messages.list) {
-			if (message.id == _fileProcess->origin.messageId) {
+			if (message.id == process->origin.messageId) {
 				const auto refresh1 = Data::RefreshFileReference(
-					_fileProcess->location,
+					process->location,
 					message.file().location);
 				const auto refresh2 = Data::RefreshFileReference(
-					_fileProcess->location,
+					process->location,
 					message.thumb().file.location);
 				if (refresh1 || refresh2) {
-					_fileProcess->requestId = fileRequest(
-						_fileProcess->location,
-						offset
-					).done([=](const MTPupload_File &result) {
-						_fileProcess->requestId = 0;
-						filePartDone(offset, result);
-					}).send();
+					filePartsResend(process);
 					return;
 				}
 			}
 		}
-		filePartUnavailable();
+		filePartUnavailable(process);
 	});
 }
 
 void ApiWrap::filePartExtractReference(
-		int64 offset,
+		not_null<FileProcess*> process,
 		const MTPstories_Stories &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+	Expects(process->referenceRequestId == 0);
 
 	const auto stories = Data::ParseStoriesSlice(
 		result.data().vstories(),
 		0);
 	for (const auto &story : stories.list) {
-		if (story.id == _fileProcess->origin.storyId) {
+		if (story.id == process->origin.storyId) {
 			const auto refresh1 = Data::RefreshFileReference(
-				_fileProcess->location,
+				process->location,
 				story.file().location);
 			const auto refresh2 = Data::RefreshFileReference(
-				_fileProcess->location,
+				process->location,
 				story.thumb().file.location);
 			if (refresh1 || refresh2) {
-				_fileProcess->requestId = fileRequest(
-					_fileProcess->location,
-					offset
-				).done([=](const MTPupload_File &result) {
-					_fileProcess->requestId = 0;
-					filePartDone(offset, result);
-				}).send();
+				filePartsResend(process);
 				return;
 			}
 		}
 	}
-	filePartUnavailable();
+	filePartUnavailable(process);
 }
 
-void ApiWrap::filePartUnavailable() {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartsResend(not_null<FileProcess*> process) {
+	for (const auto &request : process->requests) {
+		if (!request.requestId && request.bytes.isEmpty()) {
+			sendFilePart(process, request.offset);
+		}
+	}
+	loadFilePart(process);
+}
+
+void ApiWrap::filePartUnavailable(not_null<FileProcess*> process) {
+	Expects(!process->requests.empty());
 
 	LOG(("Export Error: File unavailable."));
 
-	base::take(_fileProcess)->done(QString());
+	fileProcessFinished(process, QString());
 }
 
 void ApiWrap::error(const MTP::Error &error) {
@@ -33,6 +33,7 @@ struct FileOrigin;
 
 namespace Output {
 struct Result;
+class File;
 class Stats;
 } // namespace Output
 
@@ -45,6 +46,15 @@ public:
 	rpl::producer<MTP::Error> errors() const;
 	rpl::producer<Output::Result> ioErrors() const;
 
+	struct LoadedFile {
+		uint64 locationType = 0;
+		uint64 locationId = 0;
+		QString relativePath;
+		int64 size = 0;
+	};
+	[[nodiscard]] rpl::producer<LoadedFile> fileLoaded() const;
+	void restoreLoadedFiles(const std::vector<LoadedFile> &files);
+
 	struct StartInfo {
 		int userpicsCount = 0;
 		int storiesCount = 0;
@@ -195,6 +205,7 @@ private:
 
 	[[nodiscard]] Data::Message *currentFileMessage() const;
 	[[nodiscard]] Data::FileOrigin currentFileMessageOrigin() const;
+	[[nodiscard]] Data::FileOrigin fileMessageOrigin(int index) const;
 
 	bool processFileLoad(
 		Data::File &file,
@@ -214,16 +225,36 @@ private:
 		const Data::FileOrigin &origin,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done);
-	void loadFilePart();
-	void filePartDone(int64 offset, const MTPupload_File &result);
-	void filePartUnavailable();
-	void filePartRefreshReference(int64 offset);
-	void filePartExtractReference(
+	bool adoptPrefetchedFile(
+		const Data::File &file,
+		Fn<bool(FileProgress)> &progress,
+		FnMut<void(QString)> &done);
+	void prefetchMessageFiles();
+	void fileLoadedToDisk(
+		const Data::FileLocation &location,
+		const QString &relativePath,
+		const Output::File &file);
+	void cancelFileRequests(not_null<FileProcess*> process);
+	void cancelFilePrefetches();
+	void startFileProcess(not_null<FileProcess*> process);
+	void loadFilePart(not_null<FileProcess*> process);
+	void sendFilePart(not_null<FileProcess*> process, int64 offset);
+	void filePartDone(
+		not_null<FileProcess*> process,
 		int64 offset,
+		const MTPupload_File &result);
+	void filePartUnavailable(not_null<FileProcess*> process);
+	void filePartRefreshReference(not_null<FileProcess*> process);
+	void filePartExtractReference(
+		not_null<FileProcess*> process,
 		const MTPmessages_Messages &result);
 	void filePartExtractReference(
-		int64 offset,
+		not_null<FileProcess*> process,
 		const MTPstories_Stories &result);
+	void filePartsResend(not_null<FileProcess*> process);
+	void fileProcessFinished(
+		not_null<FileProcess*> process,
+		const QString &relativePath);
 
 	template <typename Request>
 	class RequestBuilder;
@@ -235,7 +266,7 @@ private:
 	[[nodiscard]] auto splitRequest(int index, Request &&request);
 
 	[[nodiscard]] auto fileRequest(
-		const Data::FileLocation &location,
+		not_null<FileProcess*> process,
 		int64 offset);
 
 	void error(const MTP::Error &error);
@@ -257,6 +288,7 @@ private:
 	std::unique_ptr<StoriesProcess> _storiesProcess;
 	std::unique_ptr<OtherDataProcess> _otherDataProcess;
 	std::unique_ptr<FileProcess> _fileProcess;
+	std::vector<std::unique_ptr<FileProcess>> _filePrefetches;
 	std::unique_ptr<LeftChannelsProcess> _leftChannelsProcess;
 	std::unique_ptr<DialogsProcess> _dialogsProcess;
 	std::unique_ptr<ChatProcess> _chatProcess;
@@ -266,6 +298,7 @@ private:
 
 	rpl::event_stream<MTP::Error> _errors;
 	rpl::event_stream<Output::Result> _ioErrors;
+	rpl::event_stream<LoadedFile> _fileLoaded;
 
 };
 
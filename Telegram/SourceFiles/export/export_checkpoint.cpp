@@ -0,0 +1,283 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/export_checkpoint.h"
+
+#include "export/export_settings.h"
+#include "export/data/export_data_types.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSaveFile>
+
+namespace Export {
+namespace {
+
+constexpr auto kVersion = 1;
+constexpr auto kSaveInterval = 10 * crl::time(1000);
+const auto kManifestName = u".export_checkpoint.json"_q;
+
+[[nodiscard]] QString NormalizeFolder(const QString &path) {
+	const auto result = QDir(path).absolutePath();
+	return result.endsWith('/') ? result : (result + '/');
+}
+
+[[nodiscard]] QByteArray ComputeFingerprint(const Settings &settings) {
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< qint32(kVersion)
+			<< quint32(settings.format)
+			<< quint32(settings.types)
+			<< quint32(settings.fullChats)
+			<< quint32(settings.media.types)
+			<< qint64(settings.media.sizeLimit)
+			<< qint32(settings.singlePeerFrom)
+			<< qint32(settings.singlePeerTill);
+		settings.singlePeer.match([&](const MTPDinputPeerUser &data) {
+			stream << quint64(data.vuser_id().v);
+		}, [&](const MTPDinputPeerChat &data) {
+			stream << quint64(data.vchat_id().v);
+		}, [&](const MTPDinputPeerChannel &data) {
+			stream << quint64(data.vchannel_id().v);
+		}, [](const auto &data) {
+		});
+	}
+	return QCryptographicHash::hash(
+		result,
+		QCryptographicHash::Sha1).toHex();
+}
+
+[[nodiscard]] QJsonObject ReadManifest(const QString &folder) {
+	auto file = QFile(folder + kManifestName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QJsonObject();
+	}
+	auto error = QJsonParseError{ 0, QJsonParseError::NoError };
+	const auto document = QJsonDocument::fromJson(file.readAll(), &error);
+	if (error.error != QJsonParseError::NoError || !document.isObject()) {
+		LOG(("Export Error: Bad checkpoint in '%1'.").arg(folder));
+		return QJsonObject();
+	}
+	return document.object();
+}
+
+[[nodiscard]] bool ManifestMatches(
+		const QJsonObject &manifest,
+		const QByteArray &fingerprint) {
+	return (manifest.value("version").toInt() == kVersion)
+		&& (manifest.value("settings").toString().toLatin1() == fingerprint);
+}
+
+[[nodiscard]] uint64 ReadUInt64(const QJsonValue &value) {
+	return value.toString().toULongLong();
+}
+
+[[nodiscard]] QJsonValue WriteUInt64(uint64 value) {
+	return QString::number(value);
+}
+
+} // namespace
+
+Checkpoint::Checkpoint(const Settings &settings)
+: _path(settings.path)
+, _fingerprint(ComputeFingerprint(settings)) {
+	read();
+}
+
+Checkpoint::~Checkpoint() {
+	if (_unsaved) {
+		save();
+	}
+}
+
+QString Checkpoint::FindFolder(const Settings &settings) {
+	const auto fingerprint = ComputeFingerprint(settings);
+	const auto folder = NormalizeFolder(settings.path);
+	if (ManifestMatches(ReadManifest(folder), fingerprint)) {
+		return folder;
+	}
+	const auto prefix = settings.onlySinglePeer()
+		? u"ChatExport_"_q
+		: u"DataExport_"_q;
+	const auto list = QDir(folder).entryInfoList(
+		{ prefix + '*' },
+		QDir::Dirs | QDir::NoDotAndDotDot,
+		QDir::Time);
+	for (const auto &info : list) {
+		const auto path = NormalizeFolder(info.absoluteFilePath());
+		if (ManifestMatches(ReadManifest(path), fingerprint)) {
+			return path;
+		}
+	}
+	return QString();
+}
+
+bool Checkpoint::resumed() const {
+	return _resumed;
+}
+
+std::vector<ApiWrap::LoadedFile> Checkpoint::loadedFiles() const {
+	return _files | ranges::views::values | ranges::to_vector;
+}
+
+void Checkpoint::read() {
+	const auto manifest = ReadManifest(_path);
+	if (!ManifestMatches(manifest, _fingerprint)) {
+		return;
+	}
+	_resumed = true;
+
+	auto written = 0;
+	for (const auto &value : manifest.value("dialogs").toArray()) {
+		const auto object = value.toObject();
+		auto dialog = Dialog{
+			.peerId = PeerId(PeerIdHelper(
+				ReadUInt64(object.value("peer")))),
+			.written = object.value("written").toBool(),
+		};
+		for (const auto &split : object.value("splits").toArray()) {
+			dialog.splits.push_back(split.toInt());
+		}
+		written += dialog.written ? 1 : 0;
+		_dialogs.push_back(std::move(dialog));
+	}
+
+	auto missing = 0;
+	for (const auto &value : manifest.value("files").toArray()) {
+		const auto object = value.toObject();
+		auto file = ApiWrap::LoadedFile{
+			.locationType = ReadUInt64(object.value("type")),
+			.locationId = ReadUInt64(object.value("id")),
+			.relativePath = object.value("path").toString(),
+			.size = int64(ReadUInt64(object.value("size"))),
+		};
+
+		// Files that were changed or removed after the checkpoint
+		// are loaded once again.
+		const auto info = QFileInfo(_path + file.relativePath);
+		if (file.relativePath.isEmpty()
+			|| !info.isFile()
+			|| info.size() != file.size) {
+			++missing;
+			continue;
+		}
+		const auto key = std::make_pair(file.locationType, file.locationId);
+		_files.emplace(key, std::move(file));
+	}
+	LOG(("Export Info: Resuming in '%1', "
+		"%2 of %3 dialogs written, %4 files on disk, %5 files missing."
+		).arg(_path
+		).arg(written
+		).arg(_dialogs.size()
+		).arg(_files.size()
+		).arg(missing));
+}
+
+void Checkpoint::setDialogs(const Data::DialogsInfo &info) {
+	auto dialogs = std::vector<Dialog>();
+	const auto count = int(info.chats.size() + info.left.size());
+	dialogs.reserve(count);
+	for (auto index = 0; index != count; ++index) {
+		const auto dialog = info.item(index);
+		dialogs.push_back({
+			.peerId = dialog->peerId,
+			.splits = dialog->splits,
+		});
+
+		// Keep the progress if the dialogs list didn't change.
+		if (index < int(_dialogs.size())
+			&& _dialogs[index].peerId == dialog->peerId
+			&& _dialogs[index].splits == dialog->splits) {
+			dialogs.back().written = _dialogs[index].written;
+		}
+	}
+	_dialogs = std::move(dialogs);
+	save();
+}
+
+void Checkpoint::dialogWritten(int index) {
+	Expects(index >= 0 && index < int(_dialogs.size()));
+
+	_dialogs[index].written = true;
+	saveThrottled();
+}
+
+void Checkpoint::fileLoaded(const ApiWrap::LoadedFile &file) {
+	const auto key = std::make_pair(file.locationType, file.locationId);
+	_files[key] = file;
+	saveThrottled();
+}
+
+void Checkpoint::saveThrottled() {
+	if (crl::now() - _lastSaved >= kSaveInterval) {
+		save();
+	} else {
+		_unsaved = true;
+	}
+}
+
+void Checkpoint::save() {
+	if (_removed) {
+		return;
+	}
+	_lastSaved = crl::now();
+	_unsaved = false;
+
+	auto dialogs = QJsonArray();
+	for (const auto &dialog : _dialogs) {
+		auto splits = QJsonArray();
+		for (const auto split : dialog.splits) {
+			splits.push_back(split);
+		}
+		dialogs.push_back(QJsonObject{
+			{ "peer", WriteUInt64(dialog.peerId.value) },
+			{ "splits", splits },
+			{ "written", dialog.written },
+		});
+	}
+	auto files = QJsonArray();
+	for (const auto &[key, file] : _files) {
+		files.push_back(QJsonObject{
+			{ "type", WriteUInt64(file.locationType) },
+			{ "id", WriteUInt64(file.locationId) },
+			{ "path", file.relativePath },
+			{ "size", WriteUInt64(uint64(file.size)) },
+		});
+	}
+	const auto manifest = QJsonObject{
+		{ "version", kVersion },
+		{ "settings", QString::fromLatin1(_fingerprint) },
+		{ "dialogs", dialogs },
+		{ "files", files },
+	};
+
+	const auto bytes = QJsonDocument(manifest).toJson(
+		QJsonDocument::Compact);
+	auto file = QSaveFile(_path + kManifestName);
+	if (!QDir().mkpath(_path)
+		|| !file.open(QIODevice::WriteOnly)
+		|| file.write(bytes) != bytes.size()
+		|| !file.commit()) {
+		LOG(("Export Error: Could not write checkpoint to '%1'."
+			).arg(_path));
+	}
+}
+
+void Checkpoint::remove() {
+	_removed = true;
+	QFile::remove(_path + kManifestName);
+}
+
+} // namespace Export
@@ -0,0 +1,66 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "export/export_api_wrap.h"
+
+namespace Export {
+namespace Data {
+struct DialogsInfo;
+} // namespace Data
+
+struct Settings;
+
+// Manifest of an unfinished export, kept in its output folder.
+//
+// An export with the same settings continues in the same folder and
+// takes the files listed in the manifest from the disk instead of
+// loading them again. Must be used from a single queue.
+class Checkpoint final {
+public:
+	explicit Checkpoint(const Settings &settings);
+	~Checkpoint();
+
+	// Finds an unfinished export with the same settings in the
+	// chosen folder, returns the normalized path or an empty string.
+	[[nodiscard]] static QString FindFolder(const Settings &settings);
+
+	[[nodiscard]] bool resumed() const;
+	[[nodiscard]] std::vector<ApiWrap::LoadedFile> loadedFiles() const;
+
+	void setDialogs(const Data::DialogsInfo &info);
+	void dialogWritten(int index);
+	void fileLoaded(const ApiWrap::LoadedFile &file);
+
+	void save();
+	void remove();
+
+private:
+	struct Dialog {
+		PeerId peerId = 0;
+		std::vector<int> splits;
+		bool written = false;
+	};
+
+	void read();
+	void saveThrottled();
+
+	const QString _path;
+	const QByteArray _fingerprint;
+
+	std::vector<Dialog> _dialogs;
+	std::map<std::pair<uint64, uint64>, ApiWrap::LoadedFile> _files;
+	bool _resumed = false;
+
+	crl::time _lastSaved = 0;
+	bool _unsaved = false;
+	bool _removed = false;
+
+};
+
+} // namespace Export
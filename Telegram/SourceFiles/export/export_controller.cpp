@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_controller.h"
 
 #include "export/export_api_wrap.h"
+#include "export/export_checkpoint.h"
 #include "export/export_settings.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_abstract.h"
@@ -15,11 +16,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/output/export_output_stats.h"
 #include "mtproto/mtp_instance.h"
 
+#include <crl/crl_queue.h>
+
 namespace Export {
 namespace {
 
 const auto kNullStateCallback = [](ProcessingState&) {};
 
+// Formatting of message slices is done on a separate queue, so that
+// the next slice is requested while the previous one is being written.
+constexpr auto kMaxQueuedSlices = 8;
+
 Settings NormalizeSettings(const Settings &settings) {
 	if (!settings.onlySinglePeer()) {
 		return base::duplicate(settings);
@@ -37,6 +44,7 @@ public:
 		crl::weak_on_queue<ControllerObject> weak,
 		QPointer<MTP::Instance> mtproto,
 		const MTPInputPeer &peer);
+	~ControllerObject();
 
 	rpl::producer<State> state() const;
 
@@ -64,6 +72,10 @@ private:
 	bool ioCatchError(Output::Result result);
 	void setFinishedState();
 
+	void writeDialogSliceAsync(Data::MessagesSlice &&slice);
+	Output::Result writeSync(
+		FnMut<Output::Result(Output::AbstractWriter&)> method);
+
 	//void requestPasswordState();
 	//void passwordStateDone(const MTPaccount_Password &password);
 
@@ -103,6 +115,7 @@ private:
 
 	int substepsInStep(Step step) const;
 
+	crl::weak_on_queue<ControllerObject> _weak;
 	ApiWrap _api;
 	Settings _settings;
 	Environment _environment;
@@ -130,7 +143,10 @@ private:
 	mutable int _substepsPassed = 0;
 	mutable Step _lastProcessingStep = Step::Initializing;
 
-	std::unique_ptr<Output::AbstractWriter> _writer;
+	std::shared_ptr<Output::AbstractWriter> _writer;
+	std::shared_ptr<Checkpoint> _checkpoint;
+	crl::queue _writerQueue;
+	const std::shared_ptr<std::atomic<int>> _slicesQueued;
 	std::vector<Step> _steps;
 	int _stepIndex = -1;
 
@@ -142,8 +158,10 @@ ControllerObject::ControllerObject(
 	crl::weak_on_queue<ControllerObject> weak,
 	QPointer<MTP::Instance> mtproto,
 	const MTPInputPeer &peer)
-: _api(mtproto, weak.runner())
-, _state(PasswordCheckState{}) {
+: _weak(weak)
+, _api(mtproto, weak.runner())
+, _state(PasswordCheckState{})
+, _slicesQueued(std::make_shared<std::atomic<int>>(0)) {
 	_api.errors(
 	) | rpl::start_with_next([=](const MTP::Error &error) {
 		setState(ApiErrorState{ error });
@@ -162,6 +180,11 @@ ControllerObject::ControllerObject(
 	setState(std::move(state));
 }
 
+ControllerObject::~ControllerObject() {
+	// The queued writes use the writer, that points to our _stats.
+	_writerQueue.sync([] {});
+}
+
 rpl::producer<State> ControllerObject::state() const {
 	return rpl::single(
 		_state
@@ -200,6 +223,37 @@ bool ControllerObject::ioCatchError(Output::Result result) {
 	return false;
 }
 
+void ControllerObject::writeDialogSliceAsync(Data::MessagesSlice &&slice) {
+	if (_slicesQueued->load() >= kMaxQueuedSlices) {
+		// Let the writer catch up before requesting more messages.
+		_writerQueue.sync([] {});
+	}
+	++*_slicesQueued;
+	_writerQueue.async([
+		weak = _weak,
+		writer = _writer,
+		queued = _slicesQueued,
+		slice = std::move(slice)
+	] {
+		const auto result = writer->writeDialogSlice(slice);
+		--*queued;
+		if (!result) {
+			weak.with([=](ControllerObject &that) {
+				that.ioCatchError(result);
+			});
+		}
+	});
+}
+
+Output::Result ControllerObject::writeSync(
+		FnMut<Output::Result(Output::AbstractWriter&)> method) {
+	auto result = Output::Result::Success();
+	_writerQueue.sync([&] {
+		result = method(*_writer);
+	});
+	return result;
+}
+
 //void ControllerObject::submitPassword(const QString &password) {
 //
 //}
@@ -252,9 +306,21 @@ void ControllerObject::startExport(
 	}
 	_settings = NormalizeSettings(settings);
 	_environment = environment;
+	_stats.start();
 
-	_settings.path = Output::NormalizePath(_settings);
+	const auto resume = Checkpoint::FindFolder(_settings);
+	_settings.path = resume.isEmpty()
+		? Output::NormalizePath(_settings)
+		: resume;
 	_writer = Output::CreateWriter(_settings.format);
+	_checkpoint = std::make_shared<Checkpoint>(_settings);
+	_api.restoreLoadedFiles(_checkpoint->loadedFiles());
+	_api.fileLoaded(
+	) | rpl::start_with_next([=](const ApiWrap::LoadedFile &file) {
+		_writerQueue.async([checkpoint = _checkpoint, file] {
+			checkpoint->fileLoaded(file);
+		});
+	}, _lifetime);
 	fillExportSteps();
 	exportNext();
 }
@@ -340,7 +406,13 @@ void ControllerObject::cancelExportFast() {
 
 void ControllerObject::exportNext() {
 	if (++_stepIndex >= _steps.size()) {
-		if (ioCatchError(_writer->finish())) {
+		if (ioCatchError(writeSync([&](Output::AbstractWriter &writer) {
+			auto result = writer.finish();
+			if (result) {
+				_checkpoint->remove();
+			}
+			return result;
+		}))) {
 			return;
 		}
 		_api.finishExport([=] {
@@ -486,7 +558,13 @@ void ControllerObject::exportOtherData() {
 }
 
 void ControllerObject::exportDialogs() {
-	if (ioCatchError(_writer->writeDialogsStart(_dialogsInfo))) {
+	if (ioCatchError(writeSync([&](Output::AbstractWriter &writer) {
+		auto result = writer.writeDialogsStart(_dialogsInfo);
+		if (result) {
+			_checkpoint->setDialogs(_dialogsInfo);
+		}
+		return result;
+	}))) {
 		return;
 	}
 
@@ -498,7 +576,9 @@ void ControllerObject::exportNextDialog() {
 	const auto info = _dialogsInfo.item(index);
 	if (info) {
 		_api.requestMessages(*info, [=](const Data::DialogInfo &info) {
-			if (ioCatchError(_writer->writeDialogStart(info))) {
+			if (ioCatchError(writeSync([&](Output::AbstractWriter &writer) {
+				return writer.writeDialogStart(info);
+			}))) {
 				return false;
 			}
 			_messagesWritten = 0;
@@ -511,21 +591,29 @@ void ControllerObject::exportNextDialog() {
 			setState(stateDialogs(progress));
 			return true;
 		}, [=](Data::MessagesSlice &&result) {
-			if (ioCatchError(_writer->writeDialogSlice(result))) {
-				return false;
-			}
-			_messagesWritten += result.list.size();
+			const auto count = int(result.list.size());
+			_messagesWritten += count;
+			_stats.incrementMessages(count);
+			writeDialogSliceAsync(std::move(result));
 			setState(stateDialogs(DownloadProgress()));
-			return true;
+			return !stopped();
 		}, [=] {
-			if (ioCatchError(_writer->writeDialogEnd())) {
+			if (ioCatchError(writeSync([&](Output::AbstractWriter &writer) {
+				auto result = writer.writeDialogEnd();
+				if (result) {
+					_checkpoint->dialogWritten(index);
+				}
+				return result;
+			}))) {
 				return;
 			}
 			exportNextDialog();
 		});
 		return;
 	}
-	if (ioCatchError(_writer->writeDialogsEnd())) {
+	if (ioCatchError(writeSync([](Output::AbstractWriter &writer) {
+		return writer.writeDialogsEnd();
+	}))) {
 		return;
 	}
 	exportNext();
@@ -654,6 +742,14 @@ int ControllerObject::substepsInStep(Step step) const {
 }
 
 void ControllerObject::setFinishedState() {
+	LOG(("Export Info: Finished in %1 ms, "
+		"%2 files, %3 bytes (%4 bytes/s), %5 messages (%6 messages/s)."
+		).arg(_stats.elapsed()
+		).arg(_stats.filesCount()
+		).arg(_stats.bytesCount()
+		).arg(_stats.bytesPerSecond()
+		).arg(_stats.messagesCount()
+		).arg(_stats.messagesPerSecond()));
 	setState(FinishedState{
 		_writer->mainFilePath(),
 		_stats.filesCount(),
@@ -19,7 +19,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Export {
 namespace Output {
 
-File::File(const QString &path, Stats *stats) : _path(path), _stats(stats) {
+File::File(const QString &path, Stats *stats, bool countFile)
+: _path(path)
+, _stats(stats)
+, _countFile(countFile) {
 }
 
 int64 File::size() const {
@@ -39,10 +42,6 @@ Result File::writeBlock(const QByteArray &block) {
 }
 
 Result File::writeBlockAttempt(const QByteArray &block) {
-	if (_stats && !_inStats) {
-		_inStats = true;
-		_stats->incrementFiles();
-	}
 	if (const auto result = reopen(); !result) {
 		return result;
 	}
@@ -54,6 +53,10 @@ Result File::writeBlockAttempt(const QByteArray &block) {
 		_offset += size;
 		if (_stats) {
 			_stats->incrementBytes(size);
+			if (_countFile && !_inStats) {
+				_inStats = true;
+				_stats->incrementFiles();
+			}
 		}
 		return Result::Success();
 	}
@@ -21,7 +21,8 @@ class Stats;
 
 class File {
 public:
-	File(const QString &path, Stats *stats);
+	// Pass countFile = false when the caller counts the file itself.
+	File(const QString &path, Stats *stats, bool countFile = true);
 
 	[[nodiscard]] int64 size() const;
 	[[nodiscard]] bool empty() const;
@@ -50,6 +51,7 @@ private:
 
 	Stats *_stats = nullptr;
 	bool _inStats = false;
+	bool _countFile = true;
 
 };
 
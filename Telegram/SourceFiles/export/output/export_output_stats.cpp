@@ -10,9 +10,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Export {
 namespace Output {
 
+Stats::Stats()
+: _files(0)
+, _bytes(0)
+, _messages(0)
+, _started(crl::now()) {
+}
+
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
-, _bytes(other._bytes.load()) {
+, _bytes(other._bytes.load())
+, _messages(other._messages.load())
+, _started(other._started.load()) {
+}
+
+void Stats::start() {
+	_started = crl::now();
 }
 
 void Stats::incrementFiles() {
@@ -23,6 +36,10 @@ void Stats::incrementBytes(int count) {
 	_bytes += count;
 }
 
+void Stats::incrementMessages(int count) {
+	_messages += count;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -31,5 +48,23 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+int Stats::messagesCount() const {
+	return _messages;
+}
+
+crl::time Stats::elapsed() const {
+	return crl::now() - _started;
+}
+
+int64 Stats::bytesPerSecond() const {
+	const auto ms = std::max(elapsed(), crl::time(1));
+	return (_bytes.load() * 1000) / ms;
+}
+
+int Stats::messagesPerSecond() const {
+	const auto ms = std::max(elapsed(), crl::time(1));
+	return int((int64(_messages.load()) * 1000) / ms);
+}
+
 } // namespace Output
 } // namespace Export
@@ -14,18 +14,28 @@ namespace Output {
 
 class Stats {
 public:
-	Stats() = default;
+	Stats();
 	Stats(const Stats &other);
 
+	void start();
 	void incrementFiles();
 	void incrementBytes(int count);
+	void incrementMessages(int count);
 
 	int filesCount() const;
 	int64 bytesCount() const;
+	int messagesCount() const;
+
+	// Throughput since start() was called.
+	crl::time elapsed() const;
+	int64 bytesPerSecond() const;
+	int messagesPerSecond() const;
 
 private:
 	std::atomic<int> _files;
 	std::atomic<int64> _bytes;
+	std::atomic<int> _messages;
+	std::atomic<crl::time> _started;
 
 };
 
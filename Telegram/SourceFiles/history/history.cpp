@@ -27,6 +27,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_changes.h"
 #include "data/data_chat_filters.h"
 #include "data/data_scheduled_messages.h"
+#include "data/data_search_index.h"
 #include "data/data_sponsored_messages.h"
 #include "data/data_send_action.h"
 #include "data/data_folder.h"
@@ -67,6 +68,11 @@ namespace {
 
 constexpr auto kNewBlockEachMessage = 50;
 constexpr auto kSkipCloudDraftsFor = TimeId(2);
+constexpr auto kLazyResizeMinMessages = 400;
+constexpr auto kSyncResizeMessages = 200;
+constexpr auto kLazyResizeBatch = crl::time(8);
+constexpr auto kHeightsWidthBucket = 16;
+constexpr auto kHeightsCacheSize = 4;
 
 using UpdateFlag = Data::HistoryUpdate::Flag;
 
@@ -488,6 +494,7 @@ void History::destroyMessage(not_null<HistoryItem*> item) {
 					types,
 					item->id));
 			}
+			owner().searchIndex().remove(item);
 		}
 		itemRemoved(item);
 	}
@@ -3073,12 +3080,111 @@ void History::resizeToWidth(int newWidth) {
 	_flags &= ~(Flag::HasPendingResizedItems | Flag::PendingAllItemsResize);
 
 	_width = newWidth;
-	int y = 0;
-	for (const auto &block : blocks) {
+	const auto [from, till] = (request == Request::ResizeAll)
+		? countSyncResizeRange()
+		: std::make_pair(0, int(blocks.size()));
+	auto lazy = false;
+	auto y = 0;
+	for (auto i = 0, count = int(blocks.size()); i != count; ++i) {
+		const auto &block = blocks[i];
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, request);
+		const auto outside = (i < from) || (i >= till);
+		const auto stale = block->width() && (block->width() != newWidth);
+		if (stale && (outside || request == Request::ResizePending)) {
+			y += block->resizeLater(newWidth);
+			lazy = true;
+		} else {
+			y += block->resizeGetHeight(
+				newWidth,
+				outside ? Request::ResizePending : request);
+		}
 	}
 	_height = y;
+	if (lazy) {
+		scheduleLazyResize();
+	}
+}
+
+std::pair<int, int> History::countSyncResizeRange() const {
+	const auto count = int(blocks.size());
+	auto messages = 0;
+	for (const auto &block : blocks) {
+		messages += int(block->messages.size());
+	}
+	if (messages <= kLazyResizeMinMessages) {
+		return { 0, count };
+	}
+	const auto anchor = lazyResizeAnchor();
+	auto from = anchor;
+	auto till = anchor + 1;
+	auto resized = int(blocks[anchor]->messages.size());
+	while (resized < kSyncResizeMessages && (from > 0 || till < count)) {
+		if (till < count) {
+			resized += int(blocks[till++]->messages.size());
+		}
+		if (from > 0) {
+			resized += int(blocks[--from]->messages.size());
+		}
+	}
+	return { from, till };
+}
+
+int History::lazyResizeAnchor() const {
+	Expects(!blocks.empty());
+
+	// Without scrollTopItem we're scrolled to the bottom.
+	return scrollTopItem
+		? scrollTopItem->block()->indexInHistory()
+		: (int(blocks.size()) - 1);
+}
+
+void History::scheduleLazyResize() {
+	if (_flags & Flag::LazyResizeScheduled) {
+		return;
+	}
+	_flags |= Flag::LazyResizeScheduled;
+	crl::on_main(this, [=] {
+		resizeLazyBlocks();
+	});
+}
+
+void History::resizeLazyBlocks() {
+	_flags &= ~Flag::LazyResizeScheduled;
+	if (blocks.empty() || !_width) {
+		return;
+	}
+	const auto count = int(blocks.size());
+	const auto anchor = lazyResizeAnchor();
+	const auto till = crl::now() + kLazyResizeBatch;
+	auto resized = false;
+	const auto resize = [&](int index) {
+		const auto &block = blocks[index];
+		if (block->width() != _width) {
+			block->resizeGetHeight(
+				_width,
+				HistoryBlock::ResizeRequest::ResizeAll);
+			resized = true;
+		}
+		return (crl::now() < till);
+	};
+	auto finished = true;
+	for (auto distance = 0; distance != count; ++distance) {
+		const auto above = anchor - distance;
+		const auto below = anchor + distance;
+		if ((above >= 0 && !resize(above))
+			|| (distance && below < count && !resize(below))) {
+			finished = false;
+			break;
+		}
+	}
+	if (resized) {
+		// Let the widget recount the geometry keeping the scroll anchor.
+		owner().notifyHistoryChangeDelayed(this);
+		owner().sendHistoryChangeNotifications();
+	}
+	if (!finished) {
+		scheduleLazyResize();
+	}
 }
 
 void History::forceFullResize() {
@@ -3450,6 +3556,7 @@ void History::clear(ClearType type) {
 		}
 		_loadedAtTop = _loadedAtBottom = _lastMessage.has_value();
 		clearSharedMedia();
+		owner().searchIndex().removePeer(peer->id);
 		clearLastKeyboard();
 	}
 
@@ -3599,6 +3706,33 @@ int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
 		}
 	}
 	_height = y;
+	_width = newWidth;
+
+	// The least recently used width bucket is at the front.
+	const auto bucket = newWidth / kHeightsWidthBucket;
+	if (_heightsCount != int(messages.size())) {
+		_heightsCount = int(messages.size());
+		_heights.clear();
+	}
+	const auto i = ranges::find(_heights, bucket, &CachedHeight::bucket);
+	if (i != end(_heights)) {
+		_heights.erase(i);
+	} else if (_heights.size() >= kHeightsCacheSize) {
+		_heights.erase(begin(_heights));
+	}
+	_heights.push_back({ bucket, _height });
+	return _height;
+}
+
+int HistoryBlock::resizeLater(int newWidth) {
+	if (_heightsCount == int(messages.size())) {
+		const auto bucket = newWidth / kHeightsWidthBucket;
+		const auto i = ranges::find(_heights, bucket, &CachedHeight::bucket);
+		if (i != end(_heights)) {
+			_height = i->height;
+			std::rotate(i, i + 1, end(_heights));
+		}
+	}
 	return _height;
 }
 
@@ -471,6 +471,7 @@ private:
 		FakeUnreadWhileOpened = (1 << 4),
 		HasPinnedMessages = (1 << 5),
 		ResolveChatListMessage = (1 << 6),
+		LazyResizeScheduled = (1 << 7),
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) {
@@ -488,6 +489,13 @@ private:
 	// helper method for countScrollState(int top)
 	[[nodiscard]] Element *findScrollTopItem(int top) const;
 
+	// When the width changes only the blocks around the scroll position
+	// are resized right away, the rest are resized in small batches.
+	[[nodiscard]] std::pair<int, int> countSyncResizeRange() const;
+	[[nodiscard]] int lazyResizeAnchor() const;
+	void scheduleLazyResize();
+	void resizeLazyBlocks();
+
 	// this method just removes a block from the blocks list
 	// when the last item from this block was detached and
 	// calls the required previousItemChanged()
@@ -668,6 +676,12 @@ public:
 	void refreshView(not_null<Element*> view);
 
 	int resizeGetHeight(int newWidth, ResizeRequest request);
+
+	// Keeps the layout for the old width, estimating the height.
+	int resizeLater(int newWidth);
+	int width() const {
+		return _width;
+	}
 	int y() const {
 		return _y;
 	}
@@ -710,7 +724,17 @@ protected:
 	const not_null<History*> _history;
 
 	int _y = 0;
+	int _width = 0;
 	int _height = 0;
 	int _indexInHistory = -1;
 
+	struct CachedHeight {
+		int bucket = 0;
+		int height = 0;
+	};
+
+	// Heights by width bucket, valid for _heightsCount messages.
+	std::vector<CachedHeight> _heights;
+	int _heightsCount = 0;
+
 };
@@ -47,6 +47,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/notify/data_notify_settings.h"
 #include "data/data_bot_app.h"
 #include "data/data_scheduled_messages.h"
+#include "data/data_search_index.h"
 #include "data/data_changes.h"
 #include "data/data_session.h"
 #include "data/data_message_reactions.h"
@@ -2929,6 +2930,7 @@ void HistoryItem::setTextValue(TextWithEntities text) {
 	if (had) {
 		history()->owner().requestItemTextRefresh(this);
 	}
+	history()->owner().searchIndex().add(this);
 }
 
 bool HistoryItem::showNotification() const {
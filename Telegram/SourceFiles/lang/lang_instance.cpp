@@ -25,15 +25,6 @@ constexpr auto kCloudLangPackName = "tdesktop"_cs;
 constexpr auto kCustomLanguage = "#custom"_cs;
 constexpr auto kLangValuesLimit = 20000;
 
-std::vector<QString> PrepareDefaultValues() {
-	auto result = std::vector<QString>();
-	result.reserve(kKeysCount);
-	for (auto i = 0; i != kKeysCount; ++i) {
-		result.emplace_back(GetOriginalValue(ushort(i)));
-	}
-	return result;
-}
-
 class ValueParser {
 public:
 	ValueParser(
@@ -91,7 +82,12 @@ void ValueParser::appendToResult(const char *nextBegin) {
 
 bool ValueParser::logError(const QString &text) {
 	_failed = true;
-	auto loggedKey = (_currentTag.size() > 0) ? (_key + QString(':') + _currentTag) : QString(_key);
+	const auto key = _key.isEmpty()
+		? QString::number(_keyIndex)
+		: QString(_key);
+	auto loggedKey = (_currentTag.size() > 0)
+		? (key + QString(':') + _currentTag)
+		: key;
 	LOG(("Lang Error: %1 (key '%2')").arg(text, loggedKey));
 	return false;
 }
@@ -234,21 +230,21 @@ struct Instance::PrivateTag {
 };
 
 Instance::Instance()
-: _values(PrepareDefaultValues())
-, _nonDefaultSet(kKeysCount, 0) {
+: _values(kKeysCount)
+, _decoded(kKeysCount, 0)
+, _nonDefaultSet(kKeysCount, 0)
+, _nonDefaultRaw(kKeysCount) {
 }
 
 Instance::Instance(not_null<Instance*> derived, const PrivateTag &)
 : _derived(derived)
-, _nonDefaultSet(kKeysCount, 0) {
+, _nonDefaultSet(kKeysCount, 0)
+, _nonDefaultRaw(kKeysCount) {
 }
 
 void Instance::switchToId(const Language &data) {
 	reset(data);
 	if (_id == u"#TEST_X"_q || _id == u"#TEST_0"_q) {
-		for (auto &value : _values) {
-			value = PrepareTestValue(value, _id[5]);
-		}
 		if (!_derived) {
 			_updated.fire({});
 		}
@@ -291,10 +287,9 @@ void Instance::reset(const Language &data) {
 	_customFileContent = QByteArray();
 	_version = 0;
 	_nonDefaultValues.clear();
-	for (auto i = 0, count = int(_values.size()); i != count; ++i) {
-		_values[i] = GetOriginalValue(ushort(i));
-	}
 	ranges::fill(_nonDefaultSet, 0);
+	ranges::fill(_nonDefaultRaw, QByteArray());
+	invalidateValues();
 	updateChoosingStickerReplacement();
 
 	_idChanges.fire_copy(_id);
@@ -419,6 +414,7 @@ QByteArray Instance::serialize() const {
 void Instance::fillFromSerialized(
 		const QByteArray &data,
 		int dataAppVersion) {
+	const auto started = crl::now();
 	QDataStream stream(data);
 	stream.setVersion(QDataStream::Qt_5_1);
 	qint32 serializeVersion = 0;
@@ -498,6 +494,7 @@ void Instance::fillFromSerialized(
 	}
 
 	_base = nullptr;
+	invalidateValues();
 	QByteArray base;
 	if (legacyFormat) {
 		if (!stream.atEnd()) {
@@ -536,10 +533,12 @@ void Instance::fillFromSerialized(
 	_customFilePathAbsolute = customFilePathAbsolute;
 	_customFilePathRelative = customFilePathRelative;
 	_customFileContent = customFileContent;
-	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
 		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
 	}
+	LOG(("Lang Info: Loaded cached, keys: %1, %2 ms."
+		).arg(nonDefaultValuesCount
+		).arg(crl::now() - started));
 	updatePluralRules();
 	updateChoosingStickerReplacement();
 
@@ -726,22 +725,57 @@ QString Instance::getNonDefaultValue(const QByteArray &key) const {
 
 void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	_nonDefaultValues[key] = value;
-	ParseKeyValue(key, value, [&](ushort key, QString &&value) {
-		_nonDefaultSet[key] = 1;
-		if (!_derived) {
-			_values[key] = std::move(value);
-		} else if (!_derived->_nonDefaultSet[key]) {
-			_derived->_values[key] = std::move(value);
+
+	// The value is parsed only when it is asked for in decodeValue().
+	const auto keyIndex = GetKeyIndex(QLatin1String(key));
+	if (keyIndex == kKeysCount) {
+		if (!key.startsWith("cloud_")) {
+			DEBUG_LOG(("Lang Warning: Unknown key '%1'"
+				).arg(QString::fromLatin1(key)));
 		}
-		if (key == tr::lng_send_action_choose_sticker.base
-			|| key == tr::lng_user_action_choose_sticker.base) {
-			if (!_derived) {
-				updateChoosingStickerReplacement();
-			} else {
-				_derived->updateChoosingStickerReplacement();
+		return;
+	}
+	const auto owner = _derived ? _derived : this;
+	_nonDefaultSet[keyIndex] = 1;
+	_nonDefaultRaw[keyIndex] = value;
+	owner->_decoded[keyIndex] = 0;
+	if (keyIndex == tr::lng_send_action_choose_sticker.base
+		|| keyIndex == tr::lng_user_action_choose_sticker.base) {
+		owner->updateChoosingStickerReplacement();
+	}
+}
+
+void Instance::decodeValue(ushort key) const {
+	Expects(!_derived);
+
+	const auto parsed = [&](const Instance *instance) {
+		auto result = std::optional<QString>();
+		if (instance && instance->_nonDefaultSet[key]) {
+			const auto name = QByteArray();
+			auto parser = ValueParser(
+				name,
+				key,
+				instance->_nonDefaultRaw[key]);
+			if (parser.parse()) {
+				result = parser.takeResult();
 			}
 		}
-	});
+		return result;
+	};
+	auto value = parsed(this);
+	if (!value) {
+		value = parsed(_base.get());
+	}
+	auto result = value ? std::move(*value) : GetOriginalValue(key);
+	if (_id == u"#TEST_X"_q || _id == u"#TEST_0"_q) {
+		result = PrepareTestValue(result, _id[5]);
+	}
+	_values[key] = std::move(result);
+	_decoded[key] = 1;
+}
+
+void Instance::invalidateValues() {
+	ranges::fill((_derived ? _derived : this)->_decoded, 0);
 }
 
 void Instance::updatePluralRules() {
@@ -760,24 +794,13 @@ void Instance::resetValue(const QByteArray &key) {
 
 	const auto keyIndex = GetKeyIndex(QLatin1String(key));
 	if (keyIndex != kKeysCount) {
+		const auto owner = _derived ? _derived : this;
 		_nonDefaultSet[keyIndex] = 0;
-		if (!_derived) {
-			const auto base = _base
-				? _base->getNonDefaultValue(key)
-				: QString();
-			_values[keyIndex] = !base.isEmpty()
-				? base
-				: GetOriginalValue(keyIndex);
-		} else if (!_derived->_nonDefaultSet[keyIndex]) {
-			_derived->_values[keyIndex] = GetOriginalValue(keyIndex);
-		}
+		_nonDefaultRaw[keyIndex] = QByteArray();
+		owner->_decoded[keyIndex] = 0;
 		if (keyIndex == tr::lng_send_action_choose_sticker.base
 			|| keyIndex == tr::lng_user_action_choose_sticker.base) {
-			if (!_derived) {
-				updateChoosingStickerReplacement();
-			} else {
-				_derived->updateChoosingStickerReplacement();
-			}
+			owner->updateChoosingStickerReplacement();
 		}
 	}
 }
@@ -89,9 +89,13 @@ public:
 		return _updated.events();
 	}
 
+	// Values are parsed on the first access, main thread only.
 	QString getValue(ushort key) const {
 		Expects(key < _values.size());
 
+		if (!_decoded[key]) {
+			decodeValue(key);
+		}
 		return _values[key];
 	}
 	QString getNonDefaultValue(const QByteArray &key) const;
@@ -123,6 +127,8 @@ private:
 		const QString &relativePath,
 		const QByteArray &content);
 	void updateChoosingStickerReplacement();
+	void decodeValue(ushort key) const;
+	void invalidateValues();
 
 	Instance *_derived = nullptr;
 
@@ -143,8 +149,10 @@ private:
 
 	mutable QString _systemLanguage;
 
-	std::vector<QString> _values;
+	mutable std::vector<QString> _values;
+	mutable std::vector<uchar> _decoded;
 	std::vector<uchar> _nonDefaultSet;
+	std::vector<QByteArray> _nonDefaultRaw;
 	std::map<QByteArray, QByteArray> _nonDefaultValues;
 
 	std::unique_ptr<Instance> _base;
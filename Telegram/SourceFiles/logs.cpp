@@ -12,9 +12,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/launcher.h"
 #include "mtproto/facade.h"
 
+#include <condition_variable>
+#include <thread>
+
 namespace {
 
+// Debug logs are written to disk from a separate thread in batches.
+constexpr auto kDebugQueueSize = 64 * 1024; // Must be a power of two.
+constexpr auto kDebugWakeEach = 1024;
+constexpr auto kDebugFlushTimeout = std::chrono::milliseconds(100);
+
 std::atomic<int> ThreadCounter/* = 0*/;
+std::atomic<int64> DroppedCounter/* = 0*/;
 thread_local bool WritingEntryFlag/* = false*/;
 
 class WritingEntryScope final {
@@ -38,6 +47,72 @@ enum LogDataType {
 	LogDataCount
 };
 
+// Bounded multiple producers single consumer queue, never blocks.
+class LogsQueue final {
+public:
+	LogsQueue() : _slots(std::make_unique<Slot[]>(kDebugQueueSize)) {
+		for (auto i = 0; i != kDebugQueueSize; ++i) {
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Returns the record position or -1 if the queue is full.
+	int64 push(LogDataType type, const QString &msg) {
+		auto position = _head.load(std::memory_order_relaxed);
+		while (true) {
+			auto &slot = _slots[position & (kDebugQueueSize - 1)];
+			const auto sequence = slot.sequence.load(
+				std::memory_order_acquire);
+			const auto difference = sequence - position;
+			if (difference == 0) {
+				if (_head.compare_exchange_weak(
+						position,
+						position + 1,
+						std::memory_order_relaxed)) {
+					slot.type = type;
+					slot.msg = msg;
+					slot.sequence.store(
+						position + 1,
+						std::memory_order_release);
+					return position;
+				}
+			} else if (difference < 0) {
+				return -1;
+			} else {
+				position = _head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Single consumer.
+	template <typename Callback>
+	bool pop(Callback &&callback) {
+		auto &slot = _slots[_tail & (kDebugQueueSize - 1)];
+		const auto sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != _tail + 1) {
+			return false;
+		}
+		callback(slot.type, base::take(slot.msg));
+		slot.sequence.store(
+			_tail + kDebugQueueSize,
+			std::memory_order_release);
+		++_tail;
+		return true;
+	}
+
+private:
+	struct Slot {
+		std::atomic<int64> sequence = 0;
+		LogDataType type = LogDataDebug;
+		QString msg;
+	};
+
+	const std::unique_ptr<Slot[]> _slots;
+	alignas(64) std::atomic<int64> _head = 0;
+	alignas(64) int64 _tail = 0;
+
+};
+
 QMutex *_logsMutex(LogDataType type, bool clear = false) {
 	static QMutex *LogsMutexes = 0;
 	if (clear) {
@@ -77,6 +152,14 @@ public:
 		for (int32 i = 0; i < LogDataCount; ++i) {
 			files[i].reset(new QFile());
 		}
+		writer = std::thread([=] { writeDebugLoop(); });
+	}
+
+	~LogsDataFields() {
+		// Everything pushed before is written by the writer thread.
+		stopping = true;
+		wake();
+		writer.join();
 	}
 
 	bool openMain() {
@@ -111,12 +194,18 @@ public:
 	}
 
 	void write(LogDataType type, const QString &msg) {
+		if (type != LogDataMain) {
+			const auto position = queue.push(type, msg);
+			if (position < 0) {
+				++DroppedCounter;
+			} else if (!(position % kDebugWakeEach)) {
+				wake();
+			}
+			return;
+		}
 		QMutexLocker lock(_logsMutex(type));
 		WritingEntryScope scope;
 
-		if (type != LogDataMain) {
-			reopenDebug();
-		}
 		const auto file = files[type].get();
 		if (!file || !file->isOpen()) {
 			return;
@@ -125,9 +214,80 @@ public:
 		file->flush();
 	}
 
+	void debugEnabledChanged() {
+		wake();
+	}
+
 private:
+	void wake() {
+		{
+			// Under the mutex, the writer may wait without a timeout.
+			auto lock = std::unique_lock(wakeMutex);
+			wakeRequested = true;
+		}
+		wakeCondition.notify_one();
+	}
+
+	// Debug files belong to the writer thread.
+	void writeDebugLoop() {
+		auto buffers = std::array<QByteArray, LogDataCount>();
+		auto dropped = int64(0);
+		while (true) {
+			const auto finishing = stopping.load();
+			wakeRequested = false;
+			while (queue.pop([&](LogDataType type, QString &&msg) {
+				buffers[type].append(msg.toUtf8());
+			})) {
+			}
+			if (const auto now = DroppedCounter.load(); now != dropped) {
+				buffers[LogDataDebug].append(QString(
+					"Logs Warning: %1 records dropped, queue is full.\n"
+				).arg(now - dropped).toUtf8());
+				dropped = now;
+			}
+			const auto haveDebug = ranges::any_of(
+				buffers,
+				[](const QByteArray &buffer) { return !buffer.isEmpty(); });
+			if (haveDebug) {
+				WritingEntryScope scope;
+				reopenDebug();
+				for (auto type = 0; type != LogDataCount; ++type) {
+					auto &buffer = buffers[type];
+					const auto file = files[type].get();
+					if (buffer.isEmpty()) {
+						continue;
+					} else if (file && file->isOpen()) {
+						file->write(buffer);
+						file->flush();
+					}
+					buffer.clear();
+				}
+			}
+			if (finishing) {
+				break;
+			}
+			// Without debug logs nothing is pushed, no need for a timer.
+			const auto woken = [&] {
+				return wakeRequested.load() || stopping.load();
+			};
+			auto lock = std::unique_lock(wakeMutex);
+			if (Logs::DebugEnabled()) {
+				wakeCondition.wait_for(lock, kDebugFlushTimeout, woken);
+			} else {
+				wakeCondition.wait(lock, woken);
+			}
+		}
+	}
+
 	std::unique_ptr<QFile> files[LogDataCount];
 
+	LogsQueue queue;
+	std::thread writer;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<bool> wakeRequested = false;
+	std::atomic<bool> stopping = false;
+
 	int32 part = -1;
 
 	bool reopen(LogDataType type, int32 dayIndex, const QString &postfix) {
@@ -332,6 +492,9 @@ bool DebugModeEnabled = false;
 
 void SetDebugEnabled(bool enabled) {
 	DebugModeEnabled = enabled;
+	if (LogsData) {
+		LogsData->debugEnabledChanged();
+	}
 }
 
 bool DebugEnabled() {
@@ -441,6 +604,10 @@ bool started() {
 	return LogsData != 0;
 }
 
+int64 droppedRecords() {
+	return DroppedCounter.load();
+}
+
 bool instanceChecked() {
 	if (!LogsData) return false;
 
@@ -26,6 +26,9 @@ void multipleInstances();
 
 void closeMain();
 
+// Debug log records dropped because the writer thread didn't keep up.
+[[nodiscard]] int64 droppedRecords();
+
 void writeMain(const QString &v);
 void writeDebug(const QString &v);
 void writeTcp(const QString &v);
@@ -28,9 +28,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_upload.h"
 #include "storage/storage_account.h"
 #include "storage/storage_facade.h"
+#include "storage/storage_shared_media.h"
 #include "storage/storage_account.h"
 #include "data/data_session.h"
 #include "data/data_changes.h"
+#include "data/data_histories.h"
 #include "data/data_user.h"
 #include "data/data_download_manager.h"
 #include "data/stickers/data_stickers.h"
@@ -117,6 +119,17 @@ Session::Session(
 		_selfUserpicView = view.cloud;
 	}, lifetime());
 
+	_storage->setSharedMediaRestore([=](PeerId peerId) {
+		local().readSharedMedia(peerId, crl::guard(this, [=](
+				std::vector<QByteArray> &&serialized) {
+			_storage->sharedMediaRestored(peerId, std::move(serialized));
+		}));
+	});
+	_storage->sharedMediaChanged(
+	) | rpl::start_with_next([=](const Storage::SharedMediaChanged &data) {
+		local().writeSharedMediaDelayed(data.peerId, data.type);
+	}, _lifetime);
+
 	crl::on_main(this, [=] {
 		using Flag = Data::PeerUpdate::Flag;
 		changes().peerUpdates(
@@ -406,14 +419,15 @@ void Session::addWindow(not_null<Window::SessionController*> controller) {
 	) | rpl::map([=](Dialogs::Key chat) {
 		return chat.peer();
 	}) | rpl::distinct_until_changed());
+	data().histories().trackDisplayed(controller);
 }
 
 bool Session::uploadsInProgress() const {
-	return !!_uploader->currentUploadId();
+	return _uploader->hasUploads();
 }
 
 void Session::uploadsStopWithConfirmation(Fn<void()> done) {
-	const auto id = _uploader->currentUploadId();
+	const auto id = _uploader->firstUploadId();
 	const auto message = data().message(id);
 	const auto exists = (message != nullptr);
 	const auto window = message
@@ -12,7 +12,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/chat/attach/attach_prepare.h"
 #include "ui/painter.h"
 #include "core/file_location.h"
-#include "base/random.h"
 #include "base/invoke_queued.h"
 #include "logs.h"
 
@@ -34,8 +33,10 @@ namespace Clip {
 namespace {
 
 constexpr auto kClipThreadsCount = 8;
+constexpr auto kClipThreadsCountMin = 2;
 constexpr auto kAverageGifSize = 320 * 240;
 constexpr auto kWaitBeforeGifPause = crl::time(200);
+constexpr auto kLateFrameDelay = crl::time(20);
 
 QImage PrepareFrame(
 		const FrameRequest &request,
@@ -203,19 +204,23 @@ Reader::Reader(const QByteArray &data, Callback &&callback)
 }
 
 void Reader::init(const Core::FileLocation &location, const QByteArray &data) {
-	if (Workers.size() < kClipThreadsCount) {
+	static const auto threadsCount = std::clamp(
+		QThread::idealThreadCount(),
+		kClipThreadsCountMin,
+		kClipThreadsCount);
+
+	// Reuse an idle thread before starting one more.
+	auto loadLevel = 0x7FFFFFFF;
+	for (int i = 0, l = int(Workers.size()); i < l; ++i) {
+		const auto level = Workers[i]->manager.loadLevel();
+		if (level < loadLevel) {
+			_threadIndex = i;
+			loadLevel = level;
+		}
+	}
+	if (loadLevel > 0 && int(Workers.size()) < threadsCount) {
 		_threadIndex = Workers.size();
 		Workers.push_back(std::make_unique<Worker>());
-	} else {
-		_threadIndex = base::RandomIndex(Workers.size());
-		auto loadLevel = 0x7FFFFFFF;
-		for (int i = 0, l = int(Workers.size()); i < l; ++i) {
-			const auto level = Workers[i]->manager.loadLevel();
-			if (level < loadLevel) {
-				_threadIndex = i;
-				loadLevel = level;
-			}
-		}
 	}
 	Workers[_threadIndex]->manager.append(this, location, data);
 }
@@ -544,6 +549,19 @@ public:
 	}
 
 	ProcessResult finishProcess(crl::time ms) {
+		const auto started = crl::now();
+		if (_nextFrameWhen && started > _nextFrameWhen + kLateFrameDelay) {
+			++_lateFrames;
+		}
+		const auto result = readAndRenderFrame(ms);
+		const auto duration = crl::now() - started;
+		_decodeDuration += duration;
+		_decodeDurationMax = std::max(_decodeDurationMax, duration);
+		++_decodedFrames;
+		return result;
+	}
+
+	ProcessResult readAndRenderFrame(crl::time ms) {
 		auto frameMs = _seekPositionMs + ms - _animationStarted;
 		auto readResult = _implementation->readFramesTill(frameMs, ms);
 		if (readResult == internal::ReaderImplementation::ReadResult::EndOfFile) {
@@ -640,6 +658,16 @@ public:
 	}
 
 	~ReaderPrivate() {
+		if (_decodedFrames) {
+			DEBUG_LOG(("Clip Info: %1x%2 decoded %3 frames, "
+				"%4 ms average, %5 ms max, %6 late."
+				).arg(_width
+				).arg(_height
+				).arg(_decodedFrames
+				).arg(_decodeDuration / float64(_decodedFrames), 0, 'f', 1
+				).arg(_decodeDurationMax
+				).arg(_lateFrames));
+		}
 		stop();
 		_data.clear();
 	}
@@ -687,6 +715,11 @@ private:
 	bool _started = false;
 	crl::time _videoPausedAtMs = 0;
 
+	crl::time _decodeDuration = 0;
+	crl::time _decodeDurationMax = 0;
+	int _decodedFrames = 0;
+	int _lateFrames = 0;
+
 	friend class Manager;
 
 };
@@ -894,25 +927,13 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
+	// Shown readers with the earliest deadlines go first, so a queue
+	// of clips on one thread delays the paused and the latest ones.
+	auto due = std::vector<std::pair<crl::time, ReaderPrivate*>>();
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
 		ReaderPrivate *reader = i.key();
 		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = nullptr;
-				return;
-			}
-			ms = crl::now();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
+			due.emplace_back(i.value(), reader);
 		} else if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
@@ -923,10 +944,33 @@ void Manager::process() {
 				continue;
 			}
 		}
-		if (!reader->_autoPausedGif && i.value() < minms) {
+		++i;
+	}
+	ranges::sort(due, [](const auto &a, const auto &b) {
+		return std::make_pair(a.second->_autoPausedGif, a.first)
+			< std::make_pair(b.second->_autoPausedGif, b.first);
+	});
+	for (const auto &[when, reader] : due) {
+		ms = crl::now();
+		const auto state = handleResult(reader, reader->process(ms), ms);
+		if (state == ResultHandleRemove) {
+			_readers.remove(reader);
+			continue;
+		} else if (state == ResultHandleStop) {
+			_processingInThread = nullptr;
+			return;
+		}
+		ms = crl::now();
+		_readers[reader] = reader->_videoPausedAtMs
+			? (ms + 86400 * 1000ULL)
+			: (reader->_nextFrameWhen && reader->_started)
+			? reader->_nextFrameWhen
+			: (ms + 86400 * 1000ULL);
+	}
+	for (auto i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
+		if (!i.key()->_autoPausedGif && i.value() < minms) {
 			minms = i.value();
 		}
-		++i;
 	}
 
 	ms = crl::now();
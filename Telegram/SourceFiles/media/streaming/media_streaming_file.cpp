@@ -486,10 +486,18 @@ bool File::isRemoteLoader() const {
 	return _reader->isRemoteLoader();
 }
 
+int64 File::size() const {
+	return _reader->size();
+}
+
 void File::setLoaderPriority(int priority) {
 	_reader->setLoaderPriority(priority);
 }
 
+void File::setPreloadBytesAhead(int64 bytes) {
+	_reader->setPreloadBytesAhead(bytes);
+}
+
 File::~File() {
 	stop();
 }
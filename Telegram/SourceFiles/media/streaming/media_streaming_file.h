@@ -40,7 +40,9 @@ public:
 	void stop(bool stillActive = false);
 
 	[[nodiscard]] bool isRemoteLoader() const;
+	[[nodiscard]] int64 size() const;
 	void setLoaderPriority(int priority);
+	void setPreloadBytesAhead(int64 bytes);
 
 	~File();
 
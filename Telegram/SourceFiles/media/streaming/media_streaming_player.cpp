@@ -21,7 +21,13 @@ namespace {
 
 constexpr auto kBufferFor = 3 * crl::time(1000);
 constexpr auto kLoadInAdvanceForRemote = 32 * crl::time(1000);
+constexpr auto kLoadInAdvanceForRemoteMin = 8 * crl::time(1000);
+constexpr auto kLoadInAdvanceForRemoteMax = 120 * crl::time(1000);
+constexpr auto kLoadInAdvanceWhilePaused = 8 * crl::time(1000);
 constexpr auto kLoadInAdvanceForLocal = 5 * crl::time(1000);
+constexpr auto kLoadInAdvanceBytesMax = int64(96 * 1024 * 1024);
+constexpr auto kPreloadBytesFor = 2 * crl::time(1000);
+constexpr auto kReceiveSpeedMeasureFor = crl::time(1000);
 constexpr auto kMsFrequency = 1000; // 1000 ms per second.
 
 // If we played for 3 seconds and got stuck it looks like we're loading
@@ -162,6 +168,11 @@ void Player::trackReceivedTill(
 	} else {
 		state.receivedTill = position;
 	}
+	if (&state == (_video
+		? &_information.video.state
+		: &_information.audio.state)) {
+		updateReceiveSpeed(state.receivedTill);
+	}
 	if (!_pauseReading
 		&& bothReceivedEnough(loadInAdvanceFor())
 		&& !receivedTillEnd()) {
@@ -316,6 +327,11 @@ bool Player::fileReady(int headerSize, Stream &&video, Stream &&audio) {
 	_totalDuration = std::max(
 		_audio ? _audio->streamDuration() : kTimeUnknown,
 		_video ? _video->streamDuration() : kTimeUnknown);
+	if (_totalDuration != kDurationUnavailable) {
+		_bytesPerSecond = _file->size() * kMsFrequency / _totalDuration;
+		_file->setPreloadBytesAhead(
+			_bytesPerSecond * kPreloadBytesFor / kMsFrequency);
+	}
 
 	Ensures(_totalDuration > 1);
 	return true;
@@ -540,6 +556,7 @@ void Player::play(const PlaybackOptions &options) {
 	_lastFailure = std::nullopt;
 
 	savePreviousReceivedTill(options, previous);
+	_receiveSpeedCheckTime = kTimeUnknown;
 	_options = options;
 	if (!Media::Audio::SupportsSpeedControl()) {
 		_options.speed = 1.;
@@ -568,7 +585,56 @@ void Player::savePreviousReceivedTill(
 }
 
 crl::time Player::loadInAdvanceFor() const {
-	return _remoteLoader ? kLoadInAdvanceForRemote : kLoadInAdvanceForLocal;
+	if (!_remoteLoader) {
+		return kLoadInAdvanceForLocal;
+	}
+	auto result = kLoadInAdvanceForRemote;
+	if (_receiveSpeed > 0.) {
+		// Keep more in advance if we load barely faster than we play,
+		// so that a short network stall doesn't stop the playback.
+		result = std::clamp(
+			crl::time(2 * kLoadInAdvanceForRemote / _receiveSpeed),
+			kLoadInAdvanceForRemoteMin,
+			kLoadInAdvanceForRemoteMax);
+	}
+	if (_bytesPerSecond > 0) {
+		// Read packets are held in memory, limit them for high bitrates.
+		result = std::min(
+			result,
+			std::max(
+				crl::time(kLoadInAdvanceBytesMax
+					* kMsFrequency
+					/ _bytesPerSecond),
+				kLoadInAdvanceForRemoteMin));
+	}
+	return _pausedByUser
+		? std::min(result, kLoadInAdvanceWhilePaused)
+		: result;
+}
+
+void Player::updateReceiveSpeed(crl::time receivedTill) {
+	const auto now = crl::now();
+	const auto restart = [&] {
+		_receiveSpeedCheckTime = now;
+		_receiveSpeedCheckTill = receivedTill;
+	};
+	if (_pauseReading
+		|| _receiveSpeedCheckTime == kTimeUnknown
+		|| receivedTill < _receiveSpeedCheckTill) {
+		// Don't count the time while we were not reading.
+		restart();
+		return;
+	}
+	const auto elapsed = now - _receiveSpeedCheckTime;
+	if (elapsed < kReceiveSpeedMeasureFor) {
+		return;
+	}
+	const auto speed = float64(receivedTill - _receiveSpeedCheckTill)
+		/ elapsed;
+	_receiveSpeed = (_receiveSpeed > 0.)
+		? (_receiveSpeed * 0.7 + speed * 0.3)
+		: speed;
+	restart();
 }
 
 crl::time Player::computeTotalDuration() const {
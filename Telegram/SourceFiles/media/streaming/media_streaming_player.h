@@ -137,6 +137,7 @@ private:
 		const PlaybackOptions &options,
 		crl::time previousReceivedTill);
 	[[nodiscard]] crl::time loadInAdvanceFor() const;
+	void updateReceiveSpeed(crl::time receivedTill);
 
 	template <typename Track>
 	int durationByPacket(const Track &track, const FFmpeg::Packet &packet);
@@ -204,7 +205,13 @@ private:
 	rpl::event_stream<bool> _fullInCache;
 	std::optional<bool> _fullInCacheSinceStart;
 
+	// Media milliseconds received per one real millisecond.
+	float64 _receiveSpeed = 0.;
+	crl::time _receiveSpeedCheckTime = kTimeUnknown;
+	crl::time _receiveSpeedCheckTill = kTimeUnknown;
+
 	crl::time _totalDuration = kTimeUnknown;
+	int64 _bytesPerSecond = 0;
 	crl::time _loopingShift = 0;
 	crl::time _previousReceivedTill = kTimeUnknown;
 	std::atomic<int> _durationByPackets = 0;
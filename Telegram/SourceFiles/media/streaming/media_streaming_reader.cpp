@@ -23,11 +23,12 @@ constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
-constexpr auto kPreloadPartsAhead = 8;
+// By default 1 MB of parts are requested from cloud ahead of reading
+// demand, for high bitrate files the player asks for up to 4 MB.
+constexpr auto kPreloadPartsAheadMax = 32;
 constexpr auto kDownloaderRequestsLimit = 8;
 
-using PartsMap = base::flat_map<uint32, QByteArray>;
+using PartsMap = base::flat_map<uint32, PartBytes>;
 
 struct ParsedCacheEntry {
 	PartsMap parts;
@@ -74,6 +75,7 @@ int MaxSliceSize(int sliceNumber, uint32 size) {
 
 bytes::const_span ParseComplexCachedMap(
 		PartsMap &result,
+		const QByteArray &buffer,
 		bytes::const_span data,
 		int maxSize) {
 	const auto takeInt = [&]() -> std::optional<uint32> {
@@ -114,14 +116,16 @@ bytes::const_span ParseComplexCachedMap(
 		}
 		result.try_emplace(
 			offset,
-			reinterpret_cast<const char*>(bytes.data()),
-			bytes.size());
+			buffer,
+			int(reinterpret_cast<const char*>(bytes.data()) - buffer.data()),
+			int(bytes.size()));
 	}
 	return data;
 }
 
 bytes::const_span ParseCachedMap(
 		PartsMap &result,
+		const QByteArray &buffer,
 		bytes::const_span data,
 		int maxSize) {
 	const auto size = int(data.size());
@@ -135,26 +139,120 @@ bytes::const_span ParseCachedMap(
 				std::min(int64(cNetDownloadChunkSize()), size - offset));
 			result.try_emplace(
 				uint32(offset),
-				reinterpret_cast<const char*>(part.data()),
-				part.size());
+				buffer,
+				int(reinterpret_cast<const char*>(part.data()) - buffer.data()),
+				int(part.size()));
 		}
 		return {};
 	}
-	return ParseComplexCachedMap(result, data, maxSize);
+	return ParseComplexCachedMap(result, buffer, data, maxSize);
+}
+
+void DetachParts(PartsMap &parts, const QByteArray &buffer) {
+	if (parts.empty()) {
+		return;
+	}
+	const auto start = [&](const PartBytes &part) {
+		return int(reinterpret_cast<const char*>(part.bytes().data())
+			- buffer.constData());
+	};
+	auto from = int(buffer.size());
+	auto till = 0;
+	for (const auto &[offset, part] : parts) {
+		from = std::min(from, start(part));
+		till = std::max(till, start(part) + part.size());
+	}
+	const auto copy = buffer.mid(from, till - from);
+	for (auto &[offset, part] : parts) {
+		const auto shift = start(part) - from;
+		const auto size = part.size();
+		part = PartBytes(copy, shift, size);
+	}
 }
 
 ParsedCacheEntry ParseCacheEntry(
-		bytes::const_span data,
+		const QByteArray &data,
 		int sliceNumber,
 		int64 size) {
 	auto result = ParsedCacheEntry();
 	const auto remaining = ParseCachedMap(
 		result.parts,
 		data,
+		bytes::make_span(data),
 		MaxSliceSize(sliceNumber, size));
 	if (!sliceNumber && ComputeIsGoodHeader(size, result.parts)) {
 		result.included = PartsMap();
-		ParseCachedMap(*result.included, remaining, MaxSliceSize(1, size));
+		ParseCachedMap(
+			*result.included,
+			data,
+			remaining,
+			MaxSliceSize(1, size));
+
+		// The header outlives the first slice, it shouldn't hold
+		// the buffer with the first slice bytes.
+		DetachParts(result.parts, data);
+	}
+	return result;
+}
+
+[[nodiscard]] bytes::const_span PartSpan(const QByteArray &part) {
+	return bytes::make_span(part);
+}
+
+[[nodiscard]] bytes::const_span PartSpan(const PartBytes &part) {
+	return part.bytes();
+}
+
+template <typename Parts> // Parts::value_type is Pair<uint32, Bytes>
+QByteArray SerializeComplexParts(const Parts &parts) {
+	auto result = QByteArray();
+	const auto count = parts.size();
+	const auto intSize = sizeof(int32);
+	result.reserve(count * cNetDownloadChunkSize() + 2 * intSize * (count + 1));
+	const auto appendInt = [&](int value) {
+		auto serialized = int32(value);
+		result.append(
+			reinterpret_cast<const char*>(&serialized),
+			intSize);
+	};
+	appendInt(count);
+	for (const auto &[offset, part] : parts) {
+		const auto bytes = PartSpan(part);
+		appendInt(offset);
+		appendInt(bytes.size());
+		result.append(
+			reinterpret_cast<const char*>(bytes.data()),
+			bytes.size());
+	}
+	return result;
+}
+
+QByteArray SerializeContinuousParts(const PartsMap &parts) {
+	Expects(!parts.empty());
+
+	// Parts of an unchanged cache entry are written back as is.
+	const auto shared = [&] {
+		if (!parts.front().second.startsBuffer()
+			|| !parts.back().second.endsBuffer()) {
+			return false;
+		}
+		for (auto i = begin(parts), j = i + 1; j != end(parts); i = j++) {
+			if (!i->second.followedBy(j->second)) {
+				return false;
+			}
+		}
+		return true;
+	}();
+	if (shared) {
+		return parts.front().second.buffer();
+	}
+	auto result = QByteArray();
+	result.reserve(parts.size() * cNetDownloadChunkSize());
+	for (const auto &[offset, part] : parts) {
+		const auto bytes = part.bytes();
+		result.append(
+			reinterpret_cast<const char*>(bytes.data()),
+			bytes.size());
 	}
 	return result;
 }
@@ -182,7 +280,7 @@ void CopyLoaded(
 		uint32 till) {
 	auto filled = offset;
 	for (const auto &part : parts) {
-		const auto bytes = bytes::make_span(part.second);
+		const auto bytes = part.second.bytes();
 		const auto partStart = part.first;
 		const auto partEnd = uint32(partStart + bytes.size());
 		const auto copyTill = std::min(partEnd, till);
@@ -198,6 +296,54 @@ void CopyLoaded(
 
 } // namespace
 
+PartBytes::PartBytes(QByteArray bytes)
+: _buffer(std::move(bytes))
+, _size(_buffer.size()) {
+}
+
+PartBytes::PartBytes(QByteArray buffer, int offset, int size)
+: _buffer(std::move(buffer))
+, _offset(offset)
+, _size(size) {
+	Expects(_offset >= 0 && _size >= 0);
+	Expects(_offset + _size <= _buffer.size());
+}
+
+bytes::const_span PartBytes::bytes() const {
+	return bytes::make_span(_buffer).subspan(_offset, _size);
+}
+
+int PartBytes::size() const {
+	return _size;
+}
+
+bool PartBytes::empty() const {
+	return !_size;
+}
+
+QByteArray PartBytes::toByteArray() const {
+	return (_offset == 0 && _size == _buffer.size())
+		? _buffer
+		: _buffer.mid(_offset, _size);
+}
+
+bool PartBytes::followedBy(const PartBytes &other) const {
+	return (_buffer.constData() == other._buffer.constData())
+		&& (_offset + _size == other._offset);
+}
+
+bool PartBytes::startsBuffer() const {
+	return !_offset;
+}
+
+bool PartBytes::endsBuffer() const {
+	return (_offset + _size == _buffer.size());
+}
+
+const QByteArray &PartBytes::buffer() const {
+	return _buffer;
+}
+
 template <int Size>
 bool Reader::StackIntVector<Size>::add(uint32 value) {
 	using namespace rpl::mappers;
@@ -261,7 +407,7 @@ void Reader::Slice::processCacheData(PartsMap &&data) {
 	}
 }
 
-void Reader::Slice::addPart(uint32 offset, QByteArray bytes) {
+void Reader::Slice::addPart(uint32 offset, PartBytes bytes) {
 	Expects(!parts.contains(offset));
 
 	parts.emplace(offset, std::move(bytes));
@@ -272,13 +418,14 @@ void Reader::Slice::addPart(uint32 offset, QByteArray bytes) {
 
 auto Reader::Slice::prepareFill(
 		uint32 from,
-		uint32 till) -> PrepareFillResult {
+		uint32 till,
+		int preloadPartsAhead) -> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / cNetDownloadChunkSize()) * cNetDownloadChunkSize();
 	const auto tillPart = (till + cNetDownloadChunkSize() - 1) / cNetDownloadChunkSize();
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
+	const auto preloadTillOffset = (tillPart + preloadPartsAhead)
 		* cNetDownloadChunkSize();
 
 	const auto after = ranges::upper_bound(
@@ -553,7 +700,10 @@ void Reader::Slices::processPart(
 	checkSliceFullLoaded(index + 1);
 }
 
-auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
+auto Reader::Slices::fill(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadPartsAhead) -> FillResult {
 	const auto inSlice = uint32(kPartsInSlice * cNetDownloadChunkSize());
 
 	Expects(!buffer.empty());
@@ -569,7 +719,7 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 		Assert(waitingForHeaderCache());
 		return {};
 	} else if (isFullInHeader()) {
-		return fillFromHeader(offset, buffer);
+		return fillFromHeader(offset, buffer, preloadPartsAhead);
 	}
 
 	auto result = FillResult();
@@ -612,9 +762,15 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	const auto secondTill = (till > (fromSlice + 1) * inSlice)
 		? (till - (fromSlice + 1) * inSlice)
 		: 0;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		preloadPartsAhead);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			preloadPartsAhead)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -646,13 +802,18 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	return result;
 }
 
-auto Reader::Slices::fillFromHeader(uint32 offset, bytes::span buffer)
--> FillResult {
+auto Reader::Slices::fillFromHeader(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadPartsAhead) -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = uint32(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(
+		from,
+		till,
+		preloadPartsAhead);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -673,7 +834,7 @@ QByteArray Reader::Slices::partForDownloader(uint32 offset) const {
 	Expects(offset < _size);
 
 	if (const auto i = _header.parts.find(offset); i != end(_header.parts)) {
-		return i->second;
+		return i->second.toByteArray();
 	} else if (isFullInHeader()) {
 		return QByteArray();
 	}
@@ -681,7 +842,7 @@ QByteArray Reader::Slices::partForDownloader(uint32 offset) const {
 	const auto index = offset / inSlice;
 	const auto &slice = _data[index];
 	const auto i = slice.parts.find(offset - index * inSlice);
-	return (i != end(slice.parts)) ? i->second : QByteArray();
+	return (i != end(slice.parts)) ? i->second.toByteArray() : QByteArray();
 }
 
 bool Reader::Slices::waitingForHeaderCache() const {
@@ -779,10 +940,7 @@ Reader::SerializedSlice Reader::Slices::serializeAndUnloadSlice(
 	const auto continuous = (continuousTill > slice.parts.back().first);
 	if (continuous) {
 		// All data is continuous.
-		result.data.reserve(count * cNetDownloadChunkSize());
-		for (const auto &[offset, part] : slice.parts) {
-			result.data.append(part);
-		}
+		result.data = SerializeContinuousParts(slice.parts);
 	} else {
 		result.data = serializeComplexSlice(slice);
 		if (writeHeaderAndSlice) {
@@ -816,7 +974,7 @@ void Reader::Slices::unloadSlice(Slice &slice) const {
 }
 
 QByteArray Reader::Slices::serializeComplexSlice(const Slice &slice) const {
-	return SerializeComplexPartsMap(slice.parts);
+	return SerializeComplexParts(slice.parts);
 }
 
 QByteArray Reader::Slices::serializeAndUnloadFirstSliceNoHeader() {
@@ -1021,7 +1179,7 @@ void Reader::checkForDownloaderReadyOffsets() {
 		if (j == end(*i->second)) {
 			return true;
 		}
-		return unavailableInBytes(offset, std::move(j->second));
+		return unavailableInBytes(offset, j->second.toByteArray());
 	};
 	const auto unavailable = [&](uint32 offset) {
 		return unavailableInBytes(offset, _slices.partForDownloader(offset))
@@ -1127,6 +1285,15 @@ bool Reader::isRemoteLoader() const {
 	return _loader->baseCacheKey().valid();
 }
 
+void Reader::setPreloadBytesAhead(int64 bytes) {
+	const auto parts = (bytes + cNetDownloadChunkSize() - 1)
+		/ cNetDownloadChunkSize();
+	_preloadPartsAhead = int(std::clamp(
+		parts,
+		int64(kPreloadPartsAheadMin),
+		int64(kPreloadPartsAheadMax)));
+}
+
 std::shared_ptr<Reader::CacheHelper> Reader::InitCacheHelper(
 		Storage::Cache::Key baseKey) {
 	if (!baseKey) {
@@ -1156,10 +1323,7 @@ void Reader::readFromCache(int sliceNumber) {
 			result = std::move(result),
 			sizes = std::move(sizes)
 		]() mutable{
-			auto entry = ParseCacheEntry(
-				bytes::make_span(result),
-				sliceNumber,
-				size);
+			auto entry = ParseCacheEntry(result, sliceNumber, size);
 			if (const auto strong = cache.lock()) {
 				QMutexLocker lock(&strong->mutex);
 				strong->results.emplace(sliceNumber, std::move(entry.parts));
@@ -1274,7 +1438,10 @@ Reader::FillState Reader::fill(
 Reader::FillState Reader::fillFromSlices(uint32 offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
-	auto result = _slices.fill(offset, buffer);
+	auto result = _slices.fill(
+		offset,
+		buffer,
+		_preloadPartsAhead.load(std::memory_order_relaxed));
 	if (result.state != FillState::Success && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return FillState::Failed;
@@ -1410,23 +1577,7 @@ Reader::~Reader() {
 
 QByteArray SerializeComplexPartsMap(
 		const base::flat_map<uint32, QByteArray> &parts) {
-	auto result = QByteArray();
-	const auto count = parts.size();
-	const auto intSize = sizeof(int32);
-	result.reserve(count * cNetDownloadChunkSize() + 2 * intSize * (count + 1));
-	const auto appendInt = [&](int value) {
-		auto serialized = int32(value);
-		result.append(
-			reinterpret_cast<const char*>(&serialized),
-			intSize);
-	};
-	appendInt(count);
-	for (const auto &[offset, part] : parts) {
-		appendInt(offset);
-		appendInt(part.size());
-		result.append(part);
-	}
-	return result;
+	return SerializeComplexParts(parts);
 }
 
 } // namespace Streaming
@@ -30,6 +30,34 @@ class Loader;
 struct LoadedPart;
 enum class Error;
 
+// Bytes of a single loaded part. Parts parsed from a cache entry share
+// the whole entry buffer instead of being copied out of it one by one.
+class PartBytes final {
+public:
+	PartBytes() = default;
+	PartBytes(QByteArray bytes);
+	PartBytes(QByteArray buffer, int offset, int size);
+
+	[[nodiscard]] bytes::const_span bytes() const;
+	[[nodiscard]] int size() const;
+	[[nodiscard]] bool empty() const;
+
+	// Shares the buffer if the part covers it fully.
+	[[nodiscard]] QByteArray toByteArray() const;
+
+	// For writing the parts of a single buffer back without copying.
+	[[nodiscard]] bool followedBy(const PartBytes &other) const;
+	[[nodiscard]] bool startsBuffer() const;
+	[[nodiscard]] bool endsBuffer() const;
+	[[nodiscard]] const QByteArray &buffer() const;
+
+private:
+	QByteArray _buffer;
+	int _offset = 0;
+	int _size = 0;
+
+};
+
 class Reader final : public base::has_weak_ptr {
 public:
 	enum class FillState : uchar {
@@ -49,6 +77,7 @@ public:
 	// Any thread.
 	[[nodiscard]] int64 size() const;
 	[[nodiscard]] bool isRemoteLoader() const;
+	void setPreloadBytesAhead(int64 bytes);
 
 	// Single thread.
 	[[nodiscard]] FillState fill(
@@ -83,12 +112,13 @@ public:
 
 private:
 	static constexpr auto kLoadFromRemoteMax = 8;
+	static constexpr auto kPreloadPartsAheadMin = 8;
 
 	struct CacheHelper;
 
 	// FileSize: Right now any file size fits 32 bit.
 
-	using PartsMap = base::flat_map<uint32, QByteArray>;
+	using PartsMap = base::flat_map<uint32, PartBytes>;
 
 	template <int Size>
 	class StackIntVector {
@@ -131,8 +161,11 @@ private:
 		};
 
 		void processCacheData(PartsMap &&data);
-		void addPart(uint32 offset, QByteArray bytes);
-		PrepareFillResult prepareFill(uint32 from, uint32 till);
+		void addPart(uint32 offset, PartBytes bytes);
+		PrepareFillResult prepareFill(
+			uint32 from,
+			uint32 till,
+			int preloadPartsAhead);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -163,7 +196,10 @@ private:
 		void processCachedSizes(const std::vector<int> &sizes);
 		void processPart(uint32 offset, QByteArray &&bytes);
 
-		[[nodiscard]] FillResult fill(uint32 offset, bytes::span buffer);
+		[[nodiscard]] FillResult fill(
+			uint32 offset,
+			bytes::span buffer,
+			int preloadPartsAhead);
 		[[nodiscard]] SerializedSlice unloadToCache();
 
 		[[nodiscard]] QByteArray partForDownloader(uint32 offset) const;
@@ -190,7 +226,8 @@ private:
 		[[nodiscard]] bool computeIsGoodHeader() const;
 		[[nodiscard]] FillResult fillFromHeader(
 			uint32 offset,
-			bytes::span buffer);
+			bytes::span buffer,
+			int preloadPartsAhead);
 		void unloadSlice(Slice &slice) const;
 		void checkSliceFullLoaded(int sliceNumber);
 		[[nodiscard]] bool checkFullInCache() const;
@@ -247,6 +284,7 @@ private:
 	std::atomic<crl::semaphore*> _waiting = nullptr;
 	std::atomic<crl::semaphore*> _sleeping = nullptr;
 	std::atomic<bool> _stopStreamingAsync = false;
+	std::atomic<int> _preloadPartsAhead = kPreloadPartsAheadMin;
 	PriorityQueue _loadingOffsets;
 
 	Slices _slices;
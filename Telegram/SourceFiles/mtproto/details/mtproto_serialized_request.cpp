@@ -9,9 +9,55 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/random.h"
 
+#include <zlib.h>
+
 namespace MTP::details {
 namespace {
 
+// Smaller bodies don't save enough to be worth compressing.
+constexpr auto kGzipMinSize = 1024;
+
+// Keep the original body if gzip saves less than 1 / kGzipMinRatio.
+constexpr auto kGzipMinRatio = 8;
+
+[[nodiscard]] bool GzipSkipType(mtpTypeId type) {
+	switch (type) {
+	case mtpc_gzip_packed:
+	case mtpc_upload_saveFilePart:
+	case mtpc_upload_saveBigFilePart:
+		return true;
+	}
+	return false;
+}
+
+[[nodiscard]] QByteArray Gzip(const void *data, int size) {
+	auto stream = z_stream();
+	const auto init = deflateInit2(
+		&stream,
+		Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED,
+		16 + MAX_WBITS,
+		8,
+		Z_DEFAULT_STRATEGY);
+	if (init != Z_OK) {
+		LOG(("MTP Error: could not init zlib stream, code: %1").arg(init));
+		return QByteArray();
+	}
+	auto result = QByteArray(deflateBound(&stream, size), Qt::Uninitialized);
+	stream.avail_in = size;
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<void*>(data));
+	stream.avail_out = result.size();
+	stream.next_out = reinterpret_cast<Bytef*>(result.data());
+	const auto done = deflate(&stream, Z_FINISH);
+	deflateEnd(&stream);
+	if (done != Z_STREAM_END) {
+		LOG(("MTP Error: could not gzip request, code: %1").arg(done));
+		return QByteArray();
+	}
+	result.resize(result.size() - stream.avail_out);
+	return result;
+}
+
 uint32 CountPaddingPrimesCount(
 		uint32 requestSize,
 		bool forAuthKeyInner) {
@@ -143,6 +189,39 @@ bool SerializedRequest::needAck() const {
 	return true;
 }
 
+int SerializedRequest::gzip() {
+	Expects(_data != nullptr);
+	Expects(_data->size() > kMessageBodyPosition);
+
+	const auto size = int(tl::count_length(*this));
+	if (size < kGzipMinSize
+		|| GzipSkipType(mtpTypeId((*_data)[kMessageBodyPosition]))) {
+		return 0;
+	}
+	const auto packed = Gzip(dataInBytes(), size);
+	if (packed.isEmpty()) {
+		return 0;
+	}
+	auto body = mtpBuffer();
+	body.reserve(kMessageBodyPosition + (packed.size() / 4) + 3);
+	body.resize(kMessageBodyPosition);
+	body.push_back(mtpc_gzip_packed);
+	MTP_bytes(packed).write(body);
+
+	const auto packedSize = int(body.size() - kMessageBodyPosition)
+		* int(sizeof(mtpPrime));
+	if (size - packedSize < size / kGzipMinRatio) {
+		return 0;
+	}
+	memcpy(
+		body.data(),
+		_data->constData(),
+		kMessageBodyPosition * sizeof(mtpPrime));
+	body[kMessageLengthPosition] = packedSize;
+	static_cast<mtpBuffer&>(*_data) = std::move(body);
+	return size - packedSize;
+}
+
 size_t SerializedRequest::sizeInBytes() const {
 	Expects(!_data || _data->size() > kMessageBodyPosition);
 	return _data ? (*_data)[kMessageLengthPosition] : 0;
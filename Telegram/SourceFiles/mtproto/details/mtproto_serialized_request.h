@@ -70,6 +70,10 @@ public:
 
 	[[nodiscard]] bool needAck() const;
 
+	// Replaces a large message body with gzip_packed if it compresses
+	// well enough, returns the amount of bytes saved.
+	int gzip();
+
 	using ResponseType = void; // don't know real response type =(
 
 private:
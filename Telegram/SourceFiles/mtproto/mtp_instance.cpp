@@ -99,6 +99,9 @@ public:
 	void restartedByTimeout(ShiftedDcId shiftedDcId);
 	[[nodiscard]] rpl::producer<ShiftedDcId> restartsByTimeout() const;
 
+	void gzipSaved(ShiftedDcId shiftedDcId, int bytes);
+	[[nodiscard]] int64 gzipSavedBytes(DcId dcId) const;
+
 	void restart();
 	void restart(ShiftedDcId shiftedDcId);
 	[[nodiscard]] int32 dcstate(ShiftedDcId shiftedDcId = 0);
@@ -240,6 +243,7 @@ private:
 	base::flat_map<ShiftedDcId, std::unique_ptr<Session>> _sessions;
 	std::vector<std::unique_ptr<Session>> _sessionsToDestroy;
 	rpl::event_stream<ShiftedDcId> _restartsByTimeout;
+	base::flat_map<DcId, int64> _gzipSavedBytes;
 
 	std::unique_ptr<ConfigLoader> _configLoader;
 	std::unique_ptr<DomainResolver> _domainResolver;
@@ -589,6 +593,15 @@ void Instance::Private::requestCDNConfig() {
 	}).send();
 }
 
+void Instance::Private::gzipSaved(ShiftedDcId shiftedDcId, int bytes) {
+	_gzipSavedBytes[BareDcId(shiftedDcId)] += bytes;
+}
+
+int64 Instance::Private::gzipSavedBytes(DcId dcId) const {
+	const auto i = _gzipSavedBytes.find(dcId);
+	return (i != end(_gzipSavedBytes)) ? i->second : 0;
+}
+
 void Instance::Private::restart() {
 	for (const auto &[shiftedDcId, session] : _sessions) {
 		session->restart();
@@ -1873,6 +1886,14 @@ void Instance::requestCDNConfig() {
 	_private->requestCDNConfig();
 }
 
+void Instance::gzipSaved(ShiftedDcId shiftedDcId, int bytes) {
+	_private->gzipSaved(shiftedDcId, bytes);
+}
+
+int64 Instance::gzipSavedBytes(DcId dcId) const {
+	return _private->gzipSavedBytes(dcId);
+}
+
 void Instance::restart() {
 	_private->restart();
 }
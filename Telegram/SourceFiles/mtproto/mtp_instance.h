@@ -140,6 +140,10 @@ public:
 	void restartedByTimeout(ShiftedDcId shiftedDcId);
 	[[nodiscard]] rpl::producer<ShiftedDcId> restartsByTimeout() const;
 
+	// Uplink bytes saved by sending gzip_packed requests.
+	void gzipSaved(ShiftedDcId shiftedDcId, int bytes);
+	[[nodiscard]] int64 gzipSavedBytes(DcId dcId) const;
+
 	void syncHttpUnixtime();
 
 	void sendAnything(ShiftedDcId shiftedDcId = 0, crl::time msCanWait = 0);
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtproto_response.h"
 #include "mtproto/mtproto_dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "core/parallel_for.h"
 #include "base/random.h"
 #include "base/qthelp_url.h"
 #include "base/openssl_help.h"
@@ -50,6 +51,21 @@ constexpr auto kRequestConfigTimeout = 8 * crl::time(1000);
 // Don't try to handle messages larger than this size.
 constexpr auto kMaxMessageLength = 16 * 1024 * 1024;
 
+constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
+constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
+constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
+
+// Large packets are decrypted by chunks of this size, each chunk is
+// hashed for the msg_key check while it is still in the CPU cache.
+constexpr auto kDecryptChunkSize = 16U * 1024U;
+
+// Several received packets are decrypted in parallel if they are large.
+constexpr auto kDecryptInParallelBytes = 64 * 1024;
+
+// How often to write the time spent in packets crypto to the log.
+constexpr auto kCryptoStatsLogTimeout = 60 * crl::time(1000);
+
 // How much time passed from send till we resend request or check its state.
 constexpr auto kCheckSentRequestTimeout = 10 * crl::time(1000);
 
@@ -136,6 +152,67 @@ void WrapInvokeAfter(
 	return different;
 }
 
+// Expects the packet size and auth_key_id to be checked already.
+// Returns an empty buffer if the msg_key check failed.
+[[nodiscard]] QByteArray DecryptPacket(
+		const mtpBuffer &packet,
+		const AuthKeyPtr &key) {
+	const auto ints = packet.constData();
+	const auto encryptedIntsCount = (uint32(packet.size())
+		- kExternalHeaderIntsCount) & ~0x03U;
+	const auto encryptedBytesCount = encryptedIntsCount * kIntSize;
+	const auto msgKey = *(MTPint128*)(ints + 2);
+
+	auto aesKey = MTPint256();
+	auto aesIV = MTPint256();
+	key->prepareAES(msgKey, aesKey, aesIV, false);
+
+	auto aes = AES_KEY();
+	AES_set_decrypt_key(reinterpret_cast<const uchar*>(&aesKey), 256, &aes);
+	auto iv = std::array<uchar, 32>();
+	memcpy(iv.data(), &aesIV, iv.size());
+
+	SHA256_CTX msgKeyLargeContext;
+	SHA256_Init(&msgKeyLargeContext);
+	SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(false), 32);
+
+	auto result = QByteArray(encryptedBytesCount, Qt::Uninitialized);
+	const auto src = reinterpret_cast<const uchar*>(
+		ints + kExternalHeaderIntsCount);
+	const auto dst = reinterpret_cast<uchar*>(result.data());
+	for (auto offset = 0U; offset != encryptedBytesCount;) {
+		const auto size = std::min(
+			encryptedBytesCount - offset,
+			kDecryptChunkSize);
+		AES_ige_encrypt(
+			src + offset,
+			dst + offset,
+			size,
+			&aes,
+			iv.data(),
+			AES_DECRYPT);
+		SHA256_Update(&msgKeyLargeContext, dst + offset, size);
+		offset += size;
+
+		// IGE chain continues from the last encrypted and decrypted blocks.
+		memcpy(iv.data(), src + offset - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+		memcpy(
+			iv.data() + AES_BLOCK_SIZE,
+			dst + offset - AES_BLOCK_SIZE,
+			AES_BLOCK_SIZE);
+	}
+
+	std::array<uchar, 32> sha256Buffer = { { 0 } };
+	SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
+
+	constexpr auto kMsgKeyShift = 8U;
+	if (ConstTimeIsDifferent(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey))) {
+		LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
+		return QByteArray();
+	}
+	return result;
+}
+
 } // namespace
 
 SessionPrivate::SessionPrivate(
@@ -465,6 +542,24 @@ mtpMsgId SessionPrivate::prepareToSend(
 	return currentLastId;
 }
 
+void SessionPrivate::gzipBeforeFirstSend(SerializedRequest &request) {
+	if (!request->requestId || request.getMsgId()) {
+		return;
+	}
+	const auto saved = request.gzip();
+	if (!saved) {
+		return;
+	}
+	DEBUG_LOG(("MTP Info: [r%1] gzip saved %2 bytes in dc %3."
+		).arg(request->requestId
+		).arg(saved
+		).arg(_shiftedDcId));
+	const auto shiftedDcId = _shiftedDcId;
+	InvokeQueued(_instance, [=, instance = _instance] {
+		instance->gzipSaved(shiftedDcId, saved);
+	});
+}
+
 mtpMsgId SessionPrivate::replaceMsgId(SerializedRequest &request, mtpMsgId newId) {
 	Expects(request->size() > 8);
 
@@ -711,6 +806,11 @@ void SessionPrivate::tryToSend() {
 			locker1.unlock();
 		}
 
+		// Compress before the container is sized from the messages.
+		for (auto &[requestId, request] : toSend) {
+			gzipBeforeFirstSend(request);
+		}
+
 		uint32 toSendCount = toSend.size();
 		if (pingRequest) ++toSendCount;
 		if (ackRequest) ++toSendCount;
@@ -1238,36 +1338,26 @@ void SessionPrivate::handleReceived() {
 
 	onReceivedSome();
 
-	while (!_connection->received().empty()) {
-		auto intsBuffer = std::move(_connection->received().front());
-		_connection->received().pop_front();
+	auto &queue = _connection->received();
+	auto packets = std::vector<mtpBuffer>(
+		std::make_move_iterator(begin(queue)),
+		std::make_move_iterator(end(queue)));
+	queue.clear();
 
-		constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
-		constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
-		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
-		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
-		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
-		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
-			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
+	const auto key = _encryptionKey;
+	const auto decrypted = decryptReceived(packets);
+	for (const auto &decryptedBuffer : decrypted) {
+		if (decryptedBuffer.isEmpty()) {
 			return restart();
-		}
-		if (_keyId != *(uint64*)ints) {
-			LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(_keyId).arg(*(uint64*)ints));
+		} else if (_encryptionKey != key) {
+			LOG(("MTP Error: auth key changed while handling received."));
 			return restart();
 		}
 
 		constexpr auto kMinPaddingSize = 12U;
 		constexpr auto kMaxPaddingSize = 1024U;
 
-		auto encryptedInts = ints + kExternalHeaderIntsCount;
-		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
-		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
-		auto msgKey = *(MTPint128*)(ints + 2);
-
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
-
+		auto encryptedBytesCount = uint32(decryptedBuffer.size());
 		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
@@ -1280,20 +1370,6 @@ void SessionPrivate::handleReceived() {
 		// Can underflow, but it is an unsigned type, so we just check the range later.
 		auto paddingSize = static_cast<uint32>(encryptedBytesCount) - static_cast<uint32>(fullDataLength);
 
-		std::array<uchar, 32> sha256Buffer = { { 0 } };
-
-		SHA256_CTX msgKeyLargeContext;
-		SHA256_Init(&msgKeyLargeContext);
-		SHA256_Update(&msgKeyLargeContext, _encryptionKey->partForMsgKey(false), 32);
-		SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
-		SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
-
-		constexpr auto kMsgKeyShift = 8U;
-		if (ConstTimeIsDifferent(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey))) {
-			LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
-			return restart();
-		}
-
 		if ((messageLength > kMaxMessageLength)
 			|| (messageLength & 0x03)
 			|| (paddingSize < kMinPaddingSize)
@@ -1411,6 +1487,65 @@ void SessionPrivate::handleReceived() {
 	}
 }
 
+std::vector<QByteArray> SessionPrivate::decryptReceived(
+		const std::vector<mtpBuffer> &packets) {
+	const auto started = crl::profile();
+
+	// Packets after a bad one are not handled, so no need to decrypt them.
+	auto good = 0;
+	auto bytes = int64();
+	for (const auto &packet : packets) {
+		const auto intsCount = uint32(packet.size());
+		const auto ints = packet.constData();
+		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
+			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
+			break;
+		} else if (_keyId != *(uint64*)ints) {
+			LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(_keyId).arg(*(uint64*)ints));
+			break;
+		}
+		bytes += intsCount * kIntSize;
+		++good;
+	}
+
+	// An empty buffer for the bad packet makes the caller restart.
+	auto result = std::vector<QByteArray>(
+		std::min(good + 1, int(packets.size())));
+
+	const auto key = _encryptionKey;
+	const auto decrypt = [&](int index) {
+		result[index] = DecryptPacket(packets[index], key);
+	};
+	if (bytes >= kDecryptInParallelBytes) {
+		Core::ParallelFor(good, 1, decrypt);
+	} else {
+		for (auto i = 0; i != good; ++i) {
+			decrypt(i);
+		}
+	}
+	cryptoDone(started, bytes);
+	return result;
+}
+
+void SessionPrivate::cryptoDone(crl::profile_time started, int64 bytes) {
+	const auto now = crl::now();
+	_cryptoTime += crl::profile() - started;
+	_cryptoBytes += bytes;
+	if (!_cryptoStatsStarted) {
+		_cryptoStatsStarted = now;
+	} else if (now - _cryptoStatsStarted >= kCryptoStatsLogTimeout) {
+		DEBUG_LOG(("MTP Info: crypto in dc %1 took %2 ms for %3 bytes "
+			"in %4 ms."
+			).arg(_shiftedDcId
+			).arg(_cryptoTime / 1000.
+			).arg(_cryptoBytes
+			).arg(now - _cryptoStatsStarted));
+		_cryptoStatsStarted = now;
+		_cryptoTime = 0;
+		_cryptoBytes = 0;
+	}
+}
+
 SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		const mtpPrime *from,
 		const mtpPrime *end,
@@ -2622,6 +2757,7 @@ bool SessionPrivate::sendSecureRequest(
 		).arg(AbstractConnection::ProtocolDcDebugId(getProtocolDcId())
 		).arg(_encryptionKey->keyId()));
 
+	const auto started = crl::profile();
 	uchar encryptedSHA256[32];
 	MTPint128 &msgKey(*(MTPint128*)(encryptedSHA256 + 8));
 
@@ -2641,6 +2777,7 @@ bool SessionPrivate::sendSecureRequest(
 		fullSize * sizeof(mtpPrime),
 		_encryptionKey,
 		msgKey);
+	cryptoDone(started, fullSize * sizeof(mtpPrime));
 
 	DEBUG_LOG(("MTP Info: sending request, size: %1, num: %2, time: %3").arg(fullSize + 6).arg((*request)[4]).arg((*request)[5]));
 
@@ -85,6 +85,9 @@ private:
 	void onReceivedSome();
 
 	void handleReceived();
+	[[nodiscard]] std::vector<QByteArray> decryptReceived(
+		const std::vector<mtpBuffer> &packets);
+	void cryptoDone(crl::profile_time started, int64 bytes);
 
 	void retryByTimer();
 	void waitConnectedFailed();
@@ -110,6 +113,7 @@ private:
 		SerializedRequest &request,
 		mtpMsgId currentLastId,
 		bool forceNewMsgId);
+	void gzipBeforeFirstSend(SerializedRequest &request);
 	mtpMsgId replaceMsgId(
 		SerializedRequest &request,
 		mtpMsgId newId);
@@ -238,6 +242,10 @@ private:
 	mtpMsgId _bindMsgId = 0;
 	crl::time _bindMessageSent = 0;
 
+	crl::time _cryptoStatsStarted = 0;
+	crl::profile_time _cryptoTime = 0;
+	int64 _cryptoBytes = 0;
+
 };
 
 } // namespace details
@@ -362,7 +362,7 @@ int32 Photo::resizeGetHeight(int32 width) {
 
 void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const PaintContext *context) {
 	const auto selected = (selection == FullSelection);
-	const auto widthChanged = _pix.width() != _width * cIntRetinaFactor();
+	const auto widthChanged = (_pixWidth != _width);
 	if (!_goodLoaded || widthChanged) {
 		ensureDataMediaCreated();
 		const auto good = !_spoiler
@@ -370,7 +370,6 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 				|| _dataMedia->image(Data::PhotoSize::Thumbnail));
 		if ((good && !_goodLoaded) || widthChanged) {
 			_goodLoaded = good;
-			_pix = QPixmap();
 			if (_goodLoaded) {
 				setPixFrom(_dataMedia->image(Data::PhotoSize::Large)
 					? _dataMedia->image(Data::PhotoSize::Large)
@@ -388,7 +387,8 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 	if (_pix.isNull()) {
 		p.fillRect(0, 0, _width, _height, st::overviewPhotoBg);
 	} else {
-		p.drawPixmap(0, 0, _pix);
+		// While the new size is being prepared the old one is scaled.
+		p.drawPixmap(QRect(0, 0, _width, _height), _pix);
 	}
 
 	if (_spoiler) {
@@ -411,13 +411,41 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 
 void Photo::setPixFrom(not_null<Image*> image) {
 	Expects(_width > 0 && _height > 0);
-
-	auto img = image->original();
-	if (!_goodLoaded) {
-		img = Images::Blur(std::move(img));
-	}
-	_pix = Ui::PixmapFromImage(
-		CropMediaFrame(std::move(img), _width, _height));
+	Expects(_dataMedia != nullptr);
+
+	const auto width = _width;
+	const auto height = _height;
+	const auto blurred = !_goodLoaded;
+	const auto generation = ++_pixGeneration;
+	_pixWidth = width;
+
+	// Scaling and blurring is done in the background, the inline
+	// thumbnail is small enough to be shown meanwhile right away.
+	const auto inlineThumbnail = _dataMedia->thumbnailInline();
+	if (_pix.isNull() && inlineThumbnail && inlineThumbnail != image) {
+		_pix = Ui::PixmapFromImage(CropMediaFrame(
+			Images::Blur(inlineThumbnail->original()),
+			width,
+			height));
+	}
+	Images::PrepareAsync({
+		.original = image->original(),
+		.key = (uint64(width)
+			| (uint64(height) << 24)
+			| (uint64(blurred ? 1 : 0) << 48)),
+		.prepare = [=](QImage original) {
+			if (blurred) {
+				original = Images::Blur(std::move(original));
+			}
+			return CropMediaFrame(std::move(original), width, height);
+		},
+		.done = crl::guard(this, [=](QImage result) {
+			if (_pixGeneration == generation) {
+				_pix = Ui::PixmapFromImage(std::move(result));
+				delegate()->repaintItem(this);
+			}
+		}),
+	});
 
 	// In case we have inline thumbnail we can unload all images and we still
 	// won't get a blank image in the media viewer when the photo is opened.
@@ -443,6 +471,11 @@ void Photo::clearSpoiler() {
 	if (_spoiler) {
 		_spoiler = nullptr;
 		_pix = QPixmap();
+
+		// Drop the frame being prepared and request a new one.
+		_pixWidth = 0;
+		++_pixGeneration;
+		_goodLoaded = false;
 		delegate()->repaintItem(this);
 	}
 }
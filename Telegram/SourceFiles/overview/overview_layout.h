@@ -216,6 +216,8 @@ private:
 	std::unique_ptr<Ui::SpoilerAnimation> _spoiler;
 
 	QPixmap _pix;
+	int _pixWidth = 0;
+	uint32 _pixGeneration = 0;
 	bool _goodLoaded = false;
 	bool _story = false;
 
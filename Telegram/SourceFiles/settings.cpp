@@ -73,5 +73,6 @@ EnhancedSetting gEnhancedOptions;
 int gNetRequestsCount = 2;
 int gNetUploadSessionsCount = 2;
 int gNetUploadRequestInterval = 500;
+int gNetUploadRequestsPerSession = 1;
 int gNetDownloadChunkSize = 128 * 1024;
 int gAlwaysDeleteFor = 0;
\ No newline at end of file
@@ -160,6 +160,7 @@ DeclareSetting(EnhancedSetting, EnhancedOptions);
 DeclareSetting(int, NetRequestsCount);
 DeclareSetting(int, NetUploadSessionsCount);
 DeclareSetting(int, NetUploadRequestInterval);
+DeclareSetting(int, NetUploadRequestsPerSession);
 DeclareSetting(int, NetDownloadChunkSize);
 
 inline bool GetEnhancedBool(const QString& key) {
@@ -199,6 +200,7 @@ inline void SetNetworkBoost(int boost) {
 	cSetNetRequestsCount(2 + (2 * GetEnhancedInt("net_speed_boost")));
 	cSetNetUploadSessionsCount(2 + (2 * GetEnhancedInt("net_speed_boost")));
 	cSetNetUploadRequestInterval(500 - (100 * GetEnhancedInt("net_speed_boost")));
+	cSetNetUploadRequestsPerSession(1 << GetEnhancedInt("net_speed_boost"));
 }
 
 inline void SetNetworkDLBoost(bool boost) {
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/details/storage_file_utilities.h"
 
 #include "mtproto/mtproto_auth_key.h"
+#include "core/parallel_for.h"
 #include "base/platform/base_platform_file_utilities.h"
 #include "base/openssl_help.h"
 #include "base/random.h"
@@ -25,6 +26,11 @@ constexpr auto TdfMagicLen = int(sizeof(TdfMagic));
 
 constexpr auto kStrongIterationsCount = 100'000;
 
+struct ReadEntry {
+	int32 version = 0;
+	QByteArray data;
+};
+
 struct WriteEntry {
 	QString basePath;
 	QString base;
@@ -236,6 +242,9 @@ void AsyncWriteManager::stop() {
 
 AsyncWriteManager Manager;
 
+// Files read beforehand by PrefetchFiles(), used from the main thread.
+base::flat_map<QString, ReadEntry> Prefetched;
+
 } // namespace
 
 QString ToFilePart(FileKey val) {
@@ -282,7 +291,9 @@ FileKey GenerateKey(const QString &basePath) {
 void ClearKey(const FileKey &key, const QString &basePath) {
 	QString name;
 	name.reserve(basePath.size() + 0x11);
-	name.append(basePath).append(ToFilePart(key)).append('0');
+	name.append(basePath).append(ToFilePart(key));
+	Prefetched.remove(name);
+	name.append('0');
 	QFile::remove(name);
 	name[name.size() - 1] = '1';
 	QFile::remove(name);
@@ -398,6 +409,7 @@ FileWriteDescriptor::~FileWriteDescriptor() {
 
 void FileWriteDescriptor::init(const QString &name) {
 	_base = _basePath + name;
+	Prefetched.remove(_base);
 	_buffer.setBuffer(&_safeData);
 	const auto opened = _buffer.open(QIODevice::WriteOnly);
 	Assert(opened);
@@ -471,8 +483,7 @@ void FileWriteDescriptor::finish() {
 	return encrypted;
 }
 
-bool ReadFile(
-		FileReadDescriptor &result,
+std::optional<ReadEntry> ReadFileEntry(
 		const QString &name,
 		const QString &basePath) {
 	const auto base = basePath + name;
@@ -564,22 +575,65 @@ bool ReadFile(
 		}
 
 		bytes.resize(dataSize);
-		result.data = bytes;
-		bytes = QByteArray();
-
-		result.version = version;
-		result.buffer.setBuffer(&result.data);
-		result.buffer.open(QIODevice::ReadOnly);
-		result.stream.setDevice(&result.buffer);
-		result.stream.setVersion(QDataStream::Qt_5_1);
 
 		if ((i == 0 && !toTry[1].isEmpty()) || i == 1) {
 			QFile::remove(toTry[1 - i]);
 		}
 
-		return true;
+		return ReadEntry{ version, std::move(bytes) };
 	}
-	return false;
+	return std::nullopt;
+}
+
+void PrefetchFiles(const std::vector<FileToRead> &files) {
+	const auto count = int(files.size());
+	if (!count) {
+		return;
+	}
+	auto results = std::vector<std::optional<ReadEntry>>(count);
+	Core::ParallelFor(count, 1, [&](int index) {
+		const auto &file = files[index];
+		results[index] = ReadFileEntry(file.name, file.basePath);
+	});
+
+	auto found = 0;
+	for (auto i = 0; i != count; ++i) {
+		if (results[i]) {
+			++found;
+			Prefetched.emplace(
+				files[i].basePath + files[i].name,
+				std::move(*results[i]));
+		}
+	}
+	DEBUG_LOG(("App Info: prefetched %1 of %2 files.").arg(found).arg(count));
+}
+
+void ClearPrefetched() {
+	Prefetched.clear();
+}
+
+bool ReadFile(
+		FileReadDescriptor &result,
+		const QString &name,
+		const QString &basePath) {
+	const auto base = basePath + name;
+	const auto i = Prefetched.find(base);
+	auto entry = (i != end(Prefetched))
+		? std::make_optional(std::move(i->second))
+		: ReadFileEntry(name, basePath);
+	if (i != end(Prefetched)) {
+		Prefetched.erase(i);
+	}
+	if (!entry) {
+		return false;
+	}
+	result.data = std::move(entry->data);
+	result.version = entry->version;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
 }
 
 bool DecryptLocal(
@@ -631,7 +685,16 @@ bool ReadEncryptedFile(
 	}
 	QByteArray encrypted;
 	result.stream >> encrypted;
+	return ReadEncryptedData(result, encrypted, key);
+}
 
+bool ReadEncryptedData(
+		FileReadDescriptor &result,
+		const QByteArray &encrypted,
+		const MTP::AuthKeyPtr &key) {
+	if (!result.version) {
+		result.version = AppVersion;
+	}
 	EncryptedDescriptor data;
 	if (!DecryptLocal(data, encrypted, key)) {
 		result.stream.setDevice(nullptr);
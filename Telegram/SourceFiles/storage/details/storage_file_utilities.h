@@ -84,6 +84,15 @@ private:
 
 };
 
+struct FileToRead {
+	QString name;
+	QString basePath;
+};
+
+// Reads the files on several threads and keeps them for ReadFile().
+void PrefetchFiles(const std::vector<FileToRead> &files);
+void ClearPrefetched();
+
 bool ReadFile(
 	FileReadDescriptor &result,
 	const QString &name,
@@ -94,6 +103,11 @@ bool DecryptLocal(
 	const QByteArray &encrypted,
 	const MTP::AuthKeyPtr &key);
 
+bool ReadEncryptedData(
+	FileReadDescriptor &result,
+	const QByteArray &encrypted,
+	const MTP::AuthKeyPtr &key);
+
 bool ReadEncryptedFile(
 	FileReadDescriptor &result,
 	const QString &name,
@@ -0,0 +1,373 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/details/storage_journal.h"
+
+#include "storage/details/storage_file_utilities.h"
+#include "storage/serialize_common.h"
+#include "base/random.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+namespace Storage {
+namespace details {
+namespace {
+
+constexpr char kMagic[] = { 'T', 'D', 'J', '$' };
+constexpr auto kMagicSize = int(sizeof(kMagic));
+constexpr auto kPlainKeysVersion = qint32(1);
+constexpr auto kVersion = qint32(2);
+constexpr auto kHeaderSize = kMagicSize + int(sizeof(qint32));
+constexpr auto kCheckSize = 4;
+
+// Random key128 and the encrypted (type, id, zero padding) block.
+constexpr auto kKeyPartSize = 0x20;
+constexpr auto kKeyBlockSize = 0x10;
+constexpr auto kPlainKeySize = int(sizeof(quint32) + sizeof(quint64));
+
+constexpr auto kRecordOverhead = kKeyPartSize
+	+ int(sizeof(qint32))
+	+ kCheckSize;
+constexpr auto kCompactMinSize = int64(64 * 1024);
+
+[[nodiscard]] int64 RecordSize(const QByteArray &value) {
+	return kRecordOverhead + value.size();
+}
+
+[[nodiscard]] QByteArray SerializeHeader() {
+	auto result = QByteArray(kMagic, kMagicSize);
+	{
+		auto stream = QDataStream(&result, QIODevice::Append);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << kVersion;
+	}
+	return result;
+}
+
+} // namespace
+
+Journal::Journal(const QString &path, const MTP::AuthKeyPtr &key)
+: _path(path)
+, _key(key) {
+	Expects(_key != nullptr);
+
+	read();
+}
+
+Journal::~Journal() = default;
+
+bool Journal::contains(Key key) const {
+	return _values.contains(key);
+}
+
+QByteArray Journal::value(Key key) const {
+	const auto i = _values.find(key);
+	return (i != end(_values)) ? i->second : QByteArray();
+}
+
+std::vector<quint64> Journal::ids(quint32 type) const {
+	auto result = std::vector<quint64>();
+	for (auto i = _values.lower_bound(Key{ type }); i != end(_values); ++i) {
+		if (i->first.type != type) {
+			break;
+		}
+		result.push_back(i->first.id);
+	}
+	return result;
+}
+
+void Journal::write(Key key, const QByteArray &value) {
+	const auto i = _values.find(key);
+	if (i != end(_values)) {
+		_liveSize -= RecordSize(i->second);
+		i->second = value;
+	} else {
+		_values.emplace(key, value);
+	}
+	_liveSize += RecordSize(value);
+	append(key, value, false);
+	compactIfNeeded();
+}
+
+void Journal::remove(Key key) {
+	const auto i = _values.find(key);
+	if (i == end(_values)) {
+		return;
+	}
+	_liveSize -= RecordSize(i->second);
+	_values.erase(i);
+	append(key, QByteArray(), true);
+	compactIfNeeded();
+}
+
+void Journal::clear() {
+	_file.close();
+	_values.clear();
+	_liveSize = _fileSize = 0;
+	QFile::remove(_path);
+}
+
+void Journal::read() {
+	auto file = QFile(_path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	const auto bytes = file.readAll();
+	file.close();
+
+	auto stream = QDataStream(bytes);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto magic = std::array<char, kMagicSize>();
+	auto version = qint32();
+	stream.readRawData(magic.data(), kMagicSize);
+	stream >> version;
+	if (stream.status() != QDataStream::Ok
+		|| memcmp(magic.data(), kMagic, kMagicSize)
+		|| (version != kVersion && version != kPlainKeysVersion)) {
+		LOG(("Journal Error: Bad header in '%1'.").arg(_path));
+		QFile::remove(_path);
+		return;
+	}
+	const auto plainKeys = (version == kPlainKeysVersion);
+
+	// A record that was not written completely ends the journal.
+	auto good = int64(kHeaderSize);
+	while (!stream.atEnd()) {
+		auto key = Key();
+		if (plainKeys) {
+			stream >> key.type >> key.id;
+		} else {
+			auto encrypted = std::array<char, kKeyPartSize>();
+			if (stream.readRawData(encrypted.data(), kKeyPartSize)
+				!= kKeyPartSize) {
+				break;
+			}
+			const auto decrypted = decryptKey(encrypted.data());
+			if (!decrypted) {
+				break;
+			}
+			key = *decrypted;
+		}
+		auto size = qint32();
+		stream >> size;
+		const auto left = bytes.size() - stream.device()->pos();
+		if (stream.status() != QDataStream::Ok
+			|| size < -1
+			|| int64(std::max(size, 0)) + kCheckSize > left) {
+			break;
+		}
+		auto value = QByteArray(std::max(size, 0), Qt::Uninitialized);
+		auto check = std::array<char, kCheckSize>();
+		stream.readRawData(value.data(), value.size());
+		stream.readRawData(check.data(), kCheckSize);
+		const auto till = stream.device()->pos();
+		const auto hash = hashMd5(
+			bytes.constData() + good,
+			till - good - kCheckSize);
+		if (memcmp(hash.data(), check.data(), kCheckSize)) {
+			break;
+		}
+		good = till;
+		if (size < 0) {
+			_values.remove(key);
+		} else {
+			_values[key] = std::move(value);
+		}
+	}
+	if (good < bytes.size()) {
+		LOG(("Journal Error: Bad record in '%1' at %2 of %3."
+			).arg(_path
+			).arg(good
+			).arg(bytes.size()));
+		QFile(_path).resize(good);
+	}
+	_fileSize = good;
+	for (const auto &[key, value] : _values) {
+		_liveSize += RecordSize(value);
+	}
+	if (plainKeys) {
+		// Rewrite the journal of an older version with encrypted keys.
+		compact();
+	} else {
+		compactIfNeeded();
+	}
+}
+
+QByteArray Journal::serializeRecord(
+		Key key,
+		const QByteArray &value,
+		bool removed) const {
+	auto plain = QByteArray(kKeyBlockSize, char(0));
+	{
+		auto stream = QDataStream(&plain, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << key.type << key.id;
+	}
+	auto result = QByteArray();
+	result.reserve(RecordSize(value));
+	result.resize(kKeyPartSize);
+	base::RandomFill(result.data(), kKeyPartSize - kKeyBlockSize);
+	MTP::aesEncryptLocal(
+		plain.constData(),
+		result.data() + kKeyPartSize - kKeyBlockSize,
+		kKeyBlockSize,
+		_key,
+		result.constData());
+	{
+		auto stream = QDataStream(&result, QIODevice::Append);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << qint32(removed ? -1 : value.size());
+		stream.writeRawData(value.constData(), value.size());
+	}
+	const auto check = hashMd5(result.constData(), result.size());
+	result.append(check.data(), kCheckSize);
+	return result;
+}
+
+auto Journal::decryptKey(const char *encrypted) const -> std::optional<Key> {
+	auto plain = QByteArray(kKeyBlockSize, Qt::Uninitialized);
+	MTP::aesDecryptLocal(
+		encrypted + kKeyPartSize - kKeyBlockSize,
+		plain.data(),
+		kKeyBlockSize,
+		_key,
+		encrypted);
+	const auto padding = plain.constData() + kPlainKeySize;
+	if (std::any_of(padding, plain.constData() + kKeyBlockSize, [](char c) {
+		return c != 0;
+	})) {
+		return std::nullopt;
+	}
+	auto stream = QDataStream(plain);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto result = Key();
+	stream >> result.type >> result.id;
+	return result;
+}
+
+void Journal::append(Key key, const QByteArray &value, bool removed) {
+	if (!openForAppend()) {
+		return;
+	}
+	const auto record = serializeRecord(key, value, removed);
+	if (_file.write(record) != record.size() || !_file.flush()) {
+		LOG(("Journal Error: Could not append to '%1'.").arg(_path));
+	}
+	_fileSize += record.size();
+}
+
+void Journal::compactIfNeeded() {
+	if (_fileSize > kCompactMinSize
+		&& _fileSize > kHeaderSize + 2 * _liveSize) {
+		compact();
+	}
+}
+
+void Journal::compact() {
+	_file.close();
+	if (_values.empty()) {
+		clear();
+		return;
+	}
+	auto file = QSaveFile(_path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Journal Error: Could not open '%1' for compaction."
+			).arg(_path));
+		return;
+	}
+	file.write(SerializeHeader());
+	for (const auto &[key, value] : _values) {
+		file.write(serializeRecord(key, value, false));
+	}
+	if (!file.commit()) {
+		LOG(("Journal Error: Could not compact '%1'.").arg(_path));
+		return;
+	}
+	DEBUG_LOG(("Journal: Compacted '%1' from %2 to %3 bytes."
+		).arg(_path
+		).arg(_fileSize
+		).arg(kHeaderSize + _liveSize));
+	_fileSize = kHeaderSize + _liveSize;
+}
+
+bool Journal::openForAppend() {
+	if (_file.isOpen()) {
+		return true;
+	}
+	QDir().mkpath(QFileInfo(_path).absolutePath());
+	_file.setFileName(_path);
+	if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		LOG(("Journal Error: Could not open '%1' for writing.").arg(_path));
+		return false;
+	}
+	_fileSize = _file.size();
+	if (!_fileSize) {
+		const auto header = SerializeHeader();
+		_file.write(header);
+		_fileSize = header.size();
+	}
+	return true;
+}
+
+QueuedJournal::QueuedJournal(
+	crl::weak_on_queue<QueuedJournal> weak,
+	const QString &path,
+	const MTP::AuthKeyPtr &key)
+: _key(key)
+, _journal(path, key) {
+}
+
+void QueuedJournal::write(
+		std::vector<std::pair<Key, QByteArray>> &&values) {
+	for (const auto &[key, value] : values) {
+		if (value.isEmpty()) {
+			_journal.remove(key);
+			continue;
+		}
+		auto data = EncryptedDescriptor(Serialize::bytearraySize(value));
+		data.stream << value;
+		_journal.write(key, PrepareEncrypted(data, _key));
+	}
+}
+
+void QueuedJournal::read(
+		std::vector<Key> &&keys,
+		Fn<void(std::vector<QByteArray>&&)> done) {
+	auto result = std::vector<QByteArray>();
+	result.reserve(keys.size());
+	for (const auto &key : keys) {
+		auto &value = result.emplace_back();
+		if (!_journal.contains(key)) {
+			continue;
+		}
+		auto data = EncryptedDescriptor();
+		if (DecryptLocal(data, _journal.value(key), _key)) {
+			data.stream >> value;
+			if (data.stream.status() == QDataStream::Ok) {
+				continue;
+			}
+		}
+		LOG(("Journal Error: Could not decrypt record %1:%2."
+			).arg(key.type
+			).arg(key.id));
+		value = QByteArray();
+		_journal.remove(key);
+	}
+	crl::on_main([done = std::move(done), result = std::move(result)](
+			) mutable {
+		done(std::move(result));
+	});
+}
+
+void QueuedJournal::clear() {
+	_journal.clear();
+}
+
+} // namespace details
+} // namespace Storage
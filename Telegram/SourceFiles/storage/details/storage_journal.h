@@ -0,0 +1,94 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/mtproto_auth_key.h"
+
+#include <QtCore/QFile>
+#include <crl/crl_object_on_queue.h>
+
+namespace Storage {
+namespace details {
+
+// Append-only file of small (already encrypted) records.
+// Each write appends one record, the whole file is rewritten only
+// when the outdated records take most of it.
+// Record keys are encrypted with the local key as well.
+class Journal final {
+public:
+	struct Key {
+		quint32 type = 0;
+		quint64 id = 0;
+
+		friend inline constexpr auto operator<=>(Key, Key) = default;
+		friend inline constexpr bool operator==(Key, Key) = default;
+	};
+
+	Journal(const QString &path, const MTP::AuthKeyPtr &key);
+	~Journal();
+
+	[[nodiscard]] bool contains(Key key) const;
+	[[nodiscard]] QByteArray value(Key key) const;
+	[[nodiscard]] std::vector<quint64> ids(quint32 type) const;
+
+	void write(Key key, const QByteArray &value);
+	void remove(Key key);
+	void clear();
+
+private:
+	void read();
+	[[nodiscard]] QByteArray serializeRecord(
+		Key key,
+		const QByteArray &value,
+		bool removed) const;
+	[[nodiscard]] std::optional<Key> decryptKey(
+		const char *encrypted) const;
+	void append(Key key, const QByteArray &value, bool removed);
+	void compactIfNeeded();
+	void compact();
+	bool openForAppend();
+
+	const QString _path;
+	const MTP::AuthKeyPtr _key;
+	QFile _file;
+	base::flat_map<Key, QByteArray> _values;
+	int64 _liveSize = 0;
+	int64 _fileSize = 0;
+
+};
+
+// Journal of plain values, used through crl::object_on_queue, so that
+// the file is read, written and the values are encrypted off main.
+class QueuedJournal final {
+public:
+	using Key = Journal::Key;
+
+	QueuedJournal(
+		crl::weak_on_queue<QueuedJournal> weak,
+		const QString &path,
+		const MTP::AuthKeyPtr &key);
+
+	// Empty values remove the records.
+	void write(std::vector<std::pair<Key, QByteArray>> &&values);
+
+	// Missing or broken records are returned as empty values,
+	// the result is delivered on main.
+	void read(
+		std::vector<Key> &&keys,
+		Fn<void(std::vector<QByteArray>&&)> done);
+
+	void clear();
+
+private:
+	const MTP::AuthKeyPtr _key;
+	Journal _journal;
+
+};
+
+} // namespace details
+} // namespace Storage
@@ -32,11 +32,30 @@ constexpr auto kMaxTrackedSuccesses = kRetryAddSessionSuccesses
 constexpr auto kRemoveSessionAfterTimeouts = 4;
 constexpr auto kResetDownloadPrioritiesTimeout = crl::time(200);
 constexpr auto kBadRequestDurationThreshold = 8 * crl::time(1000);
+constexpr auto kStartWaitedParts = 4;
+constexpr auto kMaxWaitedParts = 16;
+constexpr auto kMaxAdaptiveWaitedParts = 64;
+constexpr auto kEstimateSampleDuration = crl::time(1000);
+constexpr auto kEstimateSampleMaxDuration = 4 * kEstimateSampleDuration;
+constexpr auto kMinRttValidDuration = 10 * crl::time(1000);
+constexpr auto kShrinkWindowRttMultiplier = 4;
+constexpr auto kGrowWindowRttMultiplier = 2;
+constexpr auto kShrinkWindowSlowSuccesses = 2;
 
 // Each (session remove by timeouts) we wait for time:
 // kRetryAddSessionTimeout * max(removesCount, kMaxTrackedSessionRemoves)
 // and for successes in all remaining sessions:
 // kRetryAddSessionSuccesses * max(removesCount, kMaxTrackedSessionRemoves)
+//
+// The window of each session (maxWaitedAmount) grows by one part after
+// each fast success with a full window up to the limit, computed from the
+// estimated bandwidth-delay product of the dc, and shrinks by one part
+// when several request durations in a row show that we only fill the
+// server queue. Between the fast and slow durations the window is kept.
+
+[[nodiscard]] int MaxWaitedAmount() {
+	return kMaxAdaptiveWaitedParts * cNetDownloadChunkSize();
+}
 
 } // namespace
 
@@ -110,11 +129,12 @@ void DownloadManagerMtproto::Queue::removeSession(int index) {
 }
 
 DownloadManagerMtproto::DcSessionBalanceData::DcSessionBalanceData()
-: maxWaitedAmount(4 * cNetDownloadChunkSize()) {
+: maxWaitedAmount(kStartWaitedParts * cNetDownloadChunkSize()) {
 }
 
 DownloadManagerMtproto::DcBalanceData::DcBalanceData()
 : sessions(kStartSessionsCount) {
+	estimate.windowPerSession = kMaxWaitedParts * cNetDownloadChunkSize();
 }
 
 DownloadManagerMtproto::DownloadManagerMtproto(not_null<ApiWrap*> api)
@@ -184,7 +204,7 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 		const auto proj = [](const DcSessionBalanceData &data) {
 			return (data.requested < data.maxWaitedAmount)
 				? data.requested
-				: 16 * cNetDownloadChunkSize();
+				: MaxWaitedAmount();
 		};
 		const auto j = ranges::min_element(sessions, ranges::less(), proj);
 		return (j->requested + cNetDownloadChunkSize() <= j->maxWaitedAmount)
@@ -230,7 +250,8 @@ void DownloadManagerMtproto::requestSucceeded(
 		MTP::DcId dcId,
 		int index,
 		int amountAtRequestStart,
-		crl::time timeAtRequestStart) {
+		crl::time timeAtRequestStart,
+		int64 receivedBytes) {
 	using namespace rpl::mappers;
 
 	const auto i = _balanceData.find(dcId);
@@ -240,7 +261,8 @@ void DownloadManagerMtproto::requestSucceeded(
 	auto &data = dc.sessions[index];
 	const auto overloaded = (timeAtRequestStart <= dc.lastSessionRemove)
 		|| (amountAtRequestStart > data.maxWaitedAmount);
-	const auto parts = amountAtRequestStart / cNetDownloadChunkSize();
+	const auto part = cNetDownloadChunkSize();
+	const auto parts = amountAtRequestStart / part;
 	const auto duration = (crl::now() - timeAtRequestStart);
 	DEBUG_LOG(("Download (%1,%2) request done, duration: %3, parts: %4%5"
 		).arg(dcId
@@ -248,6 +270,7 @@ void DownloadManagerMtproto::requestSucceeded(
 		).arg(duration
 		).arg(parts
 		).arg(overloaded ? " (overloaded)" : ""));
+	updateEstimate(dc, duration, receivedBytes);
 	if (overloaded) {
 		return;
 	}
@@ -259,11 +282,26 @@ void DownloadManagerMtproto::requestSucceeded(
 		});
 		return;
 	}
-	if (amountAtRequestStart == data.maxWaitedAmount
-		&& data.maxWaitedAmount < (16 * cNetDownloadChunkSize())) {
+	const auto minRtt = dc.estimate.minRtt;
+	const auto slow = (minRtt > 0)
+		&& (duration > kShrinkWindowRttMultiplier * minRtt);
+	const auto fast = !minRtt
+		|| (duration <= kGrowWindowRttMultiplier * minRtt);
+	data.slowSuccesses = slow ? (data.slowSuccesses + 1) : 0;
+	if (data.slowSuccesses >= kShrinkWindowSlowSuccesses
+		&& data.maxWaitedAmount > kStartWaitedParts * part) {
+		data.slowSuccesses = 0;
+		data.maxWaitedAmount -= part;
+		DEBUG_LOG(("Download (%1,%2) decreased max waited amount %3."
+			).arg(dcId
+			).arg(index
+			).arg(data.maxWaitedAmount));
+	} else if (fast
+		&& amountAtRequestStart == data.maxWaitedAmount
+		&& data.maxWaitedAmount < dc.estimate.windowPerSession) {
 		data.maxWaitedAmount = std::min(
-			data.maxWaitedAmount + cNetDownloadChunkSize(),
-			16 * cNetDownloadChunkSize());
+			data.maxWaitedAmount + part,
+			dc.estimate.windowPerSession);
 		DEBUG_LOG(("Download (%1,%2) increased max waited amount %3."
 			).arg(dcId
 			).arg(index
@@ -283,7 +321,8 @@ void DownloadManagerMtproto::requestSucceeded(
 	if (dc.timeouts > 0) {
 		--dc.timeouts;
 		return;
-	} else if (dc.sessions.size() == kMaxSessionsCount) {
+	} else if (dc.sessions.size() == kMaxSessionsCount
+		|| !needMoreSessions(dc)) {
 		return;
 	}
 	const auto now = crl::now();
@@ -298,6 +337,64 @@ void DownloadManagerMtproto::requestSucceeded(
 		).arg(dc.sessions.size()));
 }
 
+void DownloadManagerMtproto::updateEstimate(
+		DcBalanceData &dc,
+		crl::time duration,
+		int64 receivedBytes) {
+	const auto now = crl::now();
+	const auto part = cNetDownloadChunkSize();
+	auto &estimate = dc.estimate;
+
+	if (!dc.sampleStart
+		|| now - dc.sampleStart > kEstimateSampleMaxDuration) {
+		// After an idle period start measuring from this request.
+		dc.sampleStart = now - duration;
+		dc.sampleBytes = 0;
+	}
+	dc.sampleBytes += receivedBytes;
+	if (const auto elapsed = now - dc.sampleStart
+		; elapsed >= kEstimateSampleDuration) {
+		const auto sample = (dc.sampleBytes * 1000) / elapsed;
+		estimate.bytesPerSecond = estimate.bytesPerSecond
+			? ((estimate.bytesPerSecond * 3 + sample) / 4)
+			: sample;
+		dc.sampleStart = now;
+		dc.sampleBytes = 0;
+	}
+
+	estimate.rtt = estimate.rtt
+		? ((estimate.rtt * 7 + duration) / 8)
+		: duration;
+	if (!estimate.minRtt
+		|| duration <= estimate.minRtt
+		|| now - dc.minRttWhen > kMinRttValidDuration) {
+		estimate.minRtt = std::max(duration, crl::time(1));
+		dc.minRttWhen = now;
+	}
+
+	// Keep twice the bandwidth-delay product in flight over all sessions.
+	const auto sessions = int64(dc.sessions.size());
+	const auto wanted = (2 * estimate.bandwidthDelayProduct()) / sessions;
+	const auto wantedParts = int((wanted + part - 1) / part);
+	estimate.windowPerSession = part * std::clamp(
+		wantedParts,
+		kMaxWaitedParts,
+		kMaxAdaptiveWaitedParts);
+}
+
+bool DownloadManagerMtproto::needMoreSessions(
+		const DcBalanceData &dc) const {
+	const auto bdp = dc.estimate.bandwidthDelayProduct();
+	if (!bdp) {
+		return true;
+	}
+	auto window = int64();
+	for (const auto &session : dc.sessions) {
+		window += session.maxWaitedAmount;
+	}
+	return (window < 2 * bdp);
+}
+
 int DownloadManagerMtproto::chooseSessionIndex(MTP::DcId dcId) const {
 	const auto i = _balanceData.find(dcId);
 	Assert(i != end(_balanceData));
@@ -350,9 +447,9 @@ void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
 	auto &session = dc.sessions.back();
 
 	// Make sure we don't send anything to that session while redirecting.
-	session.requested += (16 * cNetDownloadChunkSize()) * kMaxSessionsCount;
+	session.requested += MaxWaitedAmount() * kMaxSessionsCount;
 	queue.removeSession(index);
-	Assert(session.requested == (16 * cNetDownloadChunkSize()) * kMaxSessionsCount);
+	Assert(session.requested == MaxWaitedAmount() * kMaxSessionsCount);
 
 	dc.sessions.pop_back();
 	api().instance().killSession(MTP::downloadDcId(dcId, index));
@@ -623,7 +720,12 @@ void DownloadMtprotoTask::normalPartLoaded(
 		mtpRequestId requestId) {
 	const auto requestData = finishSentRequest(
 		requestId,
-		FinishRequestReason::Success);
+		FinishRequestReason::Success,
+		result.match([](const MTPDupload_file &data) {
+			return int64(data.vbytes().v.size());
+		}, [](const auto &) {
+			return int64();
+		}));
 	const auto owner = _owner;
 	const auto dcId = this->dcId();
 	result.match([&](const MTPDupload_fileCdnRedirect &data) {
@@ -641,7 +743,8 @@ void DownloadMtprotoTask::webPartLoaded(
 		mtpRequestId requestId) {
 	const auto requestData = finishSentRequest(
 		requestId,
-		FinishRequestReason::Success);
+		FinishRequestReason::Success,
+		result.data().vbytes().v.size());
 	const auto owner = _owner;
 	const auto dcId = this->dcId();
 	result.match([&](const MTPDupload_webFile &data) {
@@ -674,7 +777,8 @@ void DownloadMtprotoTask::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequ
 	}, [&](const MTPDupload_cdnFile &data) {
 		const auto requestData = finishSentRequest(
 			requestId,
-			FinishRequestReason::Success);
+			FinishRequestReason::Success,
+			data.vbytes().v.size());
 		const auto owner = _owner;
 		const auto dcId = this->dcId();
 		const auto guard = gsl::finally([=] {
@@ -817,7 +921,8 @@ void DownloadMtprotoTask::placeSentRequest(
 
 auto DownloadMtprotoTask::finishSentRequest(
 	mtpRequestId requestId,
-	FinishRequestReason reason)
+	FinishRequestReason reason,
+	int64 receivedBytes)
 -> RequestData {
 	auto it = _sentRequests.find(requestId);
 	Assert(it != _sentRequests.cend());
@@ -838,7 +943,8 @@ auto DownloadMtprotoTask::finishSentRequest(
 			dcId(),
 			result.sessionIndex,
 			result.requestedInSession,
-			result.sent);
+			result.sent,
+			receivedBytes);
 	}
 
 	Ensures(ok);
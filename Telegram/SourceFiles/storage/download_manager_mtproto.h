@@ -53,11 +53,23 @@ public:
 		MTP::DcId dcId,
 		int index,
 		int amountAtRequestStart,
-		crl::time timeAtRequestStart);
+		crl::time timeAtRequestStart,
+		int64 receivedBytes);
 	void checkSendNextAfterSuccess(MTP::DcId dcId);
 	[[nodiscard]] int chooseSessionIndex(MTP::DcId dcId) const;
 
 private:
+	struct BandwidthEstimate {
+		int64 bytesPerSecond = 0;
+		crl::time rtt = 0;
+		crl::time minRtt = 0;
+		int windowPerSession = 0;
+
+		[[nodiscard]] int64 bandwidthDelayProduct() const {
+			return (bytesPerSecond * minRtt) / 1000;
+		}
+	};
+
 	class Queue final {
 	public:
 		void enqueue(not_null<Task*> task, int priority);
@@ -80,6 +92,7 @@ private:
 
 		int requested = 0;
 		int successes = 0; // Since last timeout in this dc in any session.
+		int slowSuccesses = 0; // In a row, to shrink the window.
 		int maxWaitedAmount = 0;
 	};
 	struct DcBalanceData {
@@ -91,6 +104,12 @@ private:
 		int sessionRemoveTimes = 0;
 		int timeouts = 0; // Since all sessions had successes >= required.
 		int totalRequested = 0;
+
+		// Throughput is measured over sampling periods, RTT on each success.
+		BandwidthEstimate estimate;
+		crl::time sampleStart = 0;
+		int64 sampleBytes = 0;
+		crl::time minRttWhen = 0;
 	};
 
 	void checkSendNext();
@@ -103,6 +122,11 @@ private:
 	void killSessions(MTP::DcId dcId);
 
 	void resetGeneration();
+	void updateEstimate(
+		DcBalanceData &dc,
+		crl::time duration,
+		int64 receivedBytes);
+	[[nodiscard]] bool needMoreSessions(const DcBalanceData &dc) const;
 	void sessionTimedOut(MTP::DcId dcId, int index);
 	void removeSession(MTP::DcId dcId);
 
@@ -236,7 +260,8 @@ private:
 		const RequestData &requestData);
 	[[nodiscard]] RequestData finishSentRequest(
 		mtpRequestId requestId,
-		FinishRequestReason reason);
+		FinishRequestReason reason,
+		int64 receivedBytes = 0);
 	void switchToCDN(
 		const RequestData &requestData,
 		const MTPDupload_fileCdnRedirect &redirect);
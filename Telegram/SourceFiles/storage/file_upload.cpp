@@ -26,8 +26,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Storage {
 namespace {
 
-// max 512kb uploaded at the same time in each session
-constexpr auto kMaxUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024;
+// 512kb uploaded at the same time for each request slot in each session.
+constexpr auto kUploadSessionParallelSize = 512 * 1024;
+
+// Small files are uploaded together with the current one.
+constexpr auto kMaxUploadFilesParallel = 8;
+
+// How much of a file we read from disk ahead of the sent parts.
+constexpr auto kReadAheadSize = 4 * 1024 * 1024;
 
 constexpr auto kDocumentMaxPartsCountDefault = 4000;
 
@@ -56,6 +62,12 @@ constexpr auto kKillSessionTimeout = 15 * crl::time(1000);
 	return Core::IsMimeSticker(mime) ? "WEBP" : "JPG";
 }
 
+[[nodiscard]] uint32 MaxSentSize() {
+	return cNetUploadSessionsCount()
+		* cNetUploadRequestsPerSession()
+		* kUploadSessionParallelSize;
+}
+
 } // namespace
 
 struct Uploader::File {
@@ -74,14 +86,24 @@ struct Uploader::File {
 	SendMediaType type() const;
 	uint64 thumbId() const;
 	const QString &filename() const;
+	UploadFileParts &parts();
+	uint64 partsOfId() const;
+	bool uploaded();
 
 	HashMd5 md5Hash;
 
-	std::unique_ptr<QFile> docFile;
+	std::shared_ptr<QFile> docFile;
+	std::deque<QByteArray> docReadParts;
 	int64 docSize = 0;
 	int64 docPartSize = 0;
 	int docSentParts = 0;
 	int docPartsCount = 0;
+	int docPartsRead = 0;
+	bool docReading = false;
+
+	int requestsSent = 0;
+	int docRequestsSent = 0;
+	bool started = false;
 
 };
 
@@ -158,6 +180,31 @@ const QString &Uploader::File::filename() const {
 	return file ? file->filename : media.filename;
 }
 
+UploadFileParts &Uploader::File::parts() {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->fileparts
+			: file->thumbparts)
+		: media.parts;
+}
+
+uint64 Uploader::File::partsOfId() const {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->id
+			: file->thumbId)
+		: media.thumbId;
+}
+
+bool Uploader::File::uploaded() {
+	return parts().isEmpty()
+		&& (docSentParts >= docPartsCount)
+		&& !requestsSent
+		&& !docRequestsSent;
+}
+
 Uploader::Uploader(not_null<ApiWrap*> api)
 : _api(api)
 , _nextTimer([=] { sendNext(); })
@@ -364,23 +411,15 @@ void Uploader::upload(
 	sendNext();
 }
 
-void Uploader::currentFailed() {
-	auto j = queue.find(uploadingId);
-	if (j != queue.end()) {
-		const auto [msgId, file] = std::move(*j);
-		queue.erase(j);
-		notifyFailed(msgId, file);
-	}
-
-	cancelRequests();
-	dcMap.clear();
-	uploadingId = FullMsgId();
-	sentSize = 0;
-	for (int i = 0; i < cNetUploadSessionsCount(); ++i) {
-		sentSizes[i] = 0;
+void Uploader::failed(const FullMsgId &fullId) {
+	auto j = queue.find(fullId);
+	if (j == queue.end()) {
+		return;
 	}
-
-	sendNext();
+	const auto [msgId, file] = std::move(*j);
+	queue.erase(j);
+	cancelRequests(msgId);
+	notifyFailed(msgId, file);
 }
 
 void Uploader::notifyFailed(FullMsgId id, const File &file) {
@@ -398,7 +437,7 @@ void Uploader::notifyFailed(FullMsgId id, const File &file) {
 	} else if (type == SendMediaType::Secure) {
 		_secureFailed.fire_copy(id);
 	} else {
-		Unexpected("Type in Uploader::currentFailed.");
+		Unexpected("Type in Uploader::notifyFailed.");
 	}
 }
 
@@ -409,9 +448,10 @@ void Uploader::stopSessions() {
 }
 
 void Uploader::sendNext() {
-	if (sentSize >= (cNetUploadSessionsCount() * 512 * 1024) || _pausedId.msg) {
+	if (_pausedId.msg) {
 		return;
 	}
+	finishUploaded();
 
 	const auto stopping = _stopSessionsTimer.isActive();
 	if (queue.empty()) {
@@ -424,195 +464,141 @@ void Uploader::sendNext() {
 	if (stopping) {
 		_stopSessionsTimer.cancel();
 	}
-	auto i = uploadingId.msg ? queue.find(uploadingId) : queue.begin();
-	if (!uploadingId.msg) {
-		uploadingId = i->first;
-	} else if (i == queue.end()) {
-		i = queue.begin();
-		uploadingId = i->first;
+	while (sentSize < MaxSentSize() && sendNextPart()) {
 	}
-	auto &uploadingData = i->second;
+	_nextTimer.callOnce(crl::time(cNetUploadRequestInterval()));
+}
 
-	auto todc = 0;
-	for (auto dc = 1; dc != cNetUploadSessionsCount(); ++dc) {
-		if (sentSizes[dc] < sentSizes[todc]) {
-			todc = dc;
+void Uploader::finishUploaded() {
+	// Notify about uploaded files in the order they were queued.
+	while (!queue.empty() && queue.begin()->second.uploaded()) {
+		auto [fullId, file] = std::move(*queue.begin());
+		queue.erase(queue.begin());
+		fileReady(fullId, file);
+		if (_pausedId.msg) {
+			return;
 		}
 	}
+}
 
-	auto &parts = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->fileparts
-			: uploadingData.file->thumbparts)
-		: uploadingData.media.parts;
-	const auto partsOfId = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->id
-			: uploadingData.file->thumbId)
-		: uploadingData.media.thumbId;
-	if (parts.isEmpty()) {
-		if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
-			if (requestsSent.empty() && docRequestsSent.empty()) {
-				const auto options = uploadingData.file
-					? uploadingData.file->to.options
-					: Api::SendOptions();
-				const auto edit = uploadingData.file &&
-					uploadingData.file->to.replaceMediaOf;
-				const auto attachedStickers = uploadingData.file
-					? uploadingData.file->attachedStickers
-					: std::vector<MTPInputDocument>();
-				if (uploadingData.type() == SendMediaType::Photo) {
-					auto photoFilename = uploadingData.filename();
-					if (!photoFilename.endsWith(u".jpg"_q, Qt::CaseInsensitive)) {
-						// Server has some extensions checking for inputMediaUploadedPhoto,
-						// so force the extension to be .jpg anyway. It doesn't matter,
-						// because the filename from inputFile is not used anywhere.
-						photoFilename += u".jpg"_q;
-					}
-					const auto md5 = uploadingData.file
-						? uploadingData.file->filemd5
-						: uploadingData.media.jpeg_md5;
-					const auto file = MTP_inputFile(
-						MTP_long(uploadingData.id()),
-						MTP_int(uploadingData.partsCount),
-						MTP_string(photoFilename),
-						MTP_bytes(md5));
-					_photoReady.fire({
-						.fullId = uploadingId,
-						.info = {
-							.file = file,
-							.attachedStickers = attachedStickers,
-						},
-						.options = options,
-						.edit = edit,
-					});
-				} else if (uploadingData.type() == SendMediaType::File
-					|| uploadingData.type() == SendMediaType::ThemeFile
-					|| uploadingData.type() == SendMediaType::Audio) {
-					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
-
-					const auto file = (uploadingData.docSize > kUseBigFilesFrom)
-						? MTP_inputFileBig(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()))
-						: MTP_inputFile(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()),
-							MTP_bytes(docMd5));
-					const auto thumb = [&]() -> std::optional<MTPInputFile> {
-						if (!uploadingData.partsCount) {
-							return std::nullopt;
-						}
-						const auto thumbFilename = uploadingData.file
-							? uploadingData.file->thumbname
-							: (u"thumb."_q + uploadingData.media.thumbExt);
-						const auto thumbMd5 = uploadingData.file
-							? uploadingData.file->thumbmd5
-							: uploadingData.media.jpeg_md5;
-						return MTP_inputFile(
-							MTP_long(uploadingData.thumbId()),
-							MTP_int(uploadingData.partsCount),
-							MTP_string(thumbFilename),
-							MTP_bytes(thumbMd5));
-					}();
-					_documentReady.fire({
-						.fullId = uploadingId,
-						.info = {
-							.file = file,
-							.thumb = thumb,
-							.attachedStickers = attachedStickers,
-						},
-						.options = options,
-						.edit = edit,
-					});
-				} else if (uploadingData.type() == SendMediaType::Secure) {
-					_secureReady.fire({
-						uploadingId,
-						uploadingData.id(),
-						uploadingData.partsCount });
-				}
-				queue.erase(uploadingId);
-				uploadingId = FullMsgId();
-				sendNext();
-			}
-			return;
+bool Uploader::sendNextPart() {
+	auto index = 0;
+	for (auto &[fullId, file] : queue) {
+		if (index++ == kMaxUploadFilesParallel) {
+			break;
 		}
+		switch (sendPart(fullId, file)) {
+		case SendResult::Sent:
+		case SendResult::Failed: return true;
+		case SendResult::Waiting: break;
+		}
+	}
+	return false;
+}
 
-		auto &content = uploadingData.file
-			? uploadingData.file->content
-			: uploadingData.media.data;
-		QByteArray toSend;
-		if (content.isEmpty()) {
-			if (!uploadingData.docFile) {
-				const auto filepath = uploadingData.file
-					? uploadingData.file->filepath
-					: uploadingData.media.file;
-				uploadingData.docFile = std::make_unique<QFile>(filepath);
-				if (!uploadingData.docFile->open(QIODevice::ReadOnly)) {
-					currentFailed();
-					return;
-				}
-			}
-			toSend = uploadingData.docFile->read(uploadingData.docPartSize);
-			if (uploadingData.docSize <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
-			}
-		} else {
-			const auto offset = uploadingData.docSentParts
-				* uploadingData.docPartSize;
-			toSend = content.mid(offset, uploadingData.docPartSize);
-			if ((uploadingData.type() == SendMediaType::File
-				|| uploadingData.type() == SendMediaType::ThemeFile
-				|| uploadingData.type() == SendMediaType::Audio)
-				&& uploadingData.docSentParts <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
-			}
+int Uploader::chooseDc() const {
+	auto result = 0;
+	for (auto dc = 1; dc != cNetUploadSessionsCount(); ++dc) {
+		if (sentSizes[dc] < sentSizes[result]) {
+			result = dc;
 		}
-		if ((toSend.size() > uploadingData.docPartSize)
-			|| ((toSend.size() < uploadingData.docPartSize
-				&& uploadingData.docSentParts + 1 != uploadingData.docPartsCount))) {
-			currentFailed();
-			return;
+	}
+	return result;
+}
+
+void Uploader::fileReady(const FullMsgId &fullId, File &uploadingData) {
+	const auto options = uploadingData.file
+		? uploadingData.file->to.options
+		: Api::SendOptions();
+	const auto edit = uploadingData.file &&
+		uploadingData.file->to.replaceMediaOf;
+	const auto attachedStickers = uploadingData.file
+		? uploadingData.file->attachedStickers
+		: std::vector<MTPInputDocument>();
+	if (uploadingData.type() == SendMediaType::Photo) {
+		auto photoFilename = uploadingData.filename();
+		if (!photoFilename.endsWith(u".jpg"_q, Qt::CaseInsensitive)) {
+			// Server has some extensions checking for inputMediaUploadedPhoto,
+			// so force the extension to be .jpg anyway. It doesn't matter,
+			// because the filename from inputFile is not used anywhere.
+			photoFilename += u".jpg"_q;
 		}
-		mtpRequestId requestId;
-		if (uploadingData.docSize > kUseBigFilesFrom) {
-			requestId = _api->request(MTPupload_SaveBigFilePart(
+		const auto md5 = uploadingData.file
+			? uploadingData.file->filemd5
+			: uploadingData.media.jpeg_md5;
+		const auto file = MTP_inputFile(
+			MTP_long(uploadingData.id()),
+			MTP_int(uploadingData.partsCount),
+			MTP_string(photoFilename),
+			MTP_bytes(md5));
+		_photoReady.fire({
+			.fullId = fullId,
+			.info = {
+				.file = file,
+				.attachedStickers = attachedStickers,
+			},
+			.options = options,
+			.edit = edit,
+		});
+	} else if (uploadingData.type() == SendMediaType::File
+		|| uploadingData.type() == SendMediaType::ThemeFile
+		|| uploadingData.type() == SendMediaType::Audio) {
+		QByteArray docMd5(32, Qt::Uninitialized);
+		hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
+
+		const auto file = (uploadingData.docSize > kUseBigFilesFrom)
+			? MTP_inputFileBig(
 				MTP_long(uploadingData.id()),
-				MTP_int(uploadingData.docSentParts),
 				MTP_int(uploadingData.docPartsCount),
-				MTP_bytes(toSend)
-			)).done([=](const MTPBool &result, mtpRequestId requestId) {
-				partLoaded(result, requestId);
-			}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
-				partFailed(error, requestId);
-			}).toDC(MTP::uploadDcId(todc)).send();
-		} else {
-			requestId = _api->request(MTPupload_SaveFilePart(
+				MTP_string(uploadingData.filename()))
+			: MTP_inputFile(
 				MTP_long(uploadingData.id()),
-				MTP_int(uploadingData.docSentParts),
-				MTP_bytes(toSend)
-			)).done([=](const MTPBool &result, mtpRequestId requestId) {
-				partLoaded(result, requestId);
-			}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
-				partFailed(error, requestId);
-			}).toDC(MTP::uploadDcId(todc)).send();
-		}
-		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
-		dcMap.emplace(requestId, todc);
-		sentSize += uploadingData.docPartSize;
-		sentSizes[todc] += uploadingData.docPartSize;
+				MTP_int(uploadingData.docPartsCount),
+				MTP_string(uploadingData.filename()),
+				MTP_bytes(docMd5));
+		const auto thumb = [&]() -> std::optional<MTPInputFile> {
+			if (!uploadingData.partsCount) {
+				return std::nullopt;
+			}
+			const auto thumbFilename = uploadingData.file
+				? uploadingData.file->thumbname
+				: (u"thumb."_q + uploadingData.media.thumbExt);
+			const auto thumbMd5 = uploadingData.file
+				? uploadingData.file->thumbmd5
+				: uploadingData.media.jpeg_md5;
+			return MTP_inputFile(
+				MTP_long(uploadingData.thumbId()),
+				MTP_int(uploadingData.partsCount),
+				MTP_string(thumbFilename),
+				MTP_bytes(thumbMd5));
+		}();
+		_documentReady.fire({
+			.fullId = fullId,
+			.info = {
+				.file = file,
+				.thumb = thumb,
+				.attachedStickers = attachedStickers,
+			},
+			.options = options,
+			.edit = edit,
+		});
+	} else if (uploadingData.type() == SendMediaType::Secure) {
+		_secureReady.fire({
+			fullId,
+			uploadingData.id(),
+			uploadingData.partsCount });
+	}
+}
 
-		uploadingData.docSentParts++;
-	} else {
+auto Uploader::sendPart(const FullMsgId &fullId, File &uploadingData)
+-> SendResult {
+	auto &parts = uploadingData.parts();
+	if (!parts.isEmpty()) {
+		const auto todc = chooseDc();
 		auto part = parts.begin();
 
 		const auto requestId = _api->request(MTPupload_SaveFilePart(
-			MTP_long(partsOfId),
+			MTP_long(uploadingData.partsOfId()),
 			MTP_int(part.key()),
 			MTP_bytes(part.value())
 		)).done([=](const MTPBool &result, mtpRequestId requestId) {
@@ -620,33 +606,169 @@ void Uploader::sendNext() {
 		}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
 			partFailed(error, requestId);
 		}).toDC(MTP::uploadDcId(todc)).send();
-		requestsSent.emplace(requestId, part.value());
-		dcMap.emplace(requestId, todc);
+		_requests.emplace(requestId, Request{
+			.fullId = fullId,
+			.dc = todc,
+			.size = part.value().size(),
+		});
 		sentSize += part.value().size();
 		sentSizes[todc] += part.value().size();
+		++uploadingData.requestsSent;
+		uploadingData.started = true;
 
 		parts.erase(part);
+		return SendResult::Sent;
+	} else if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
+		return SendResult::Waiting;
 	}
-	_nextTimer.callOnce(crl::time(cNetUploadRequestInterval()));
+
+	auto &content = uploadingData.file
+		? uploadingData.file->content
+		: uploadingData.media.data;
+	QByteArray toSend;
+	if (content.isEmpty()) {
+		if (uploadingData.docReadParts.empty()) {
+			readNextParts(fullId, uploadingData);
+			return SendResult::Waiting;
+		}
+		toSend = std::move(uploadingData.docReadParts.front());
+		uploadingData.docReadParts.pop_front();
+		readNextParts(fullId, uploadingData);
+		if (uploadingData.docSize <= kUseBigFilesFrom) {
+			uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
+		}
+	} else {
+		const auto offset = uploadingData.docSentParts
+			* uploadingData.docPartSize;
+		toSend = content.mid(offset, uploadingData.docPartSize);
+		if ((uploadingData.type() == SendMediaType::File
+			|| uploadingData.type() == SendMediaType::ThemeFile
+			|| uploadingData.type() == SendMediaType::Audio)
+			&& uploadingData.docSentParts <= kUseBigFilesFrom) {
+			uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
+		}
+	}
+	if ((toSend.size() > uploadingData.docPartSize)
+		|| ((toSend.size() < uploadingData.docPartSize
+			&& uploadingData.docSentParts + 1 != uploadingData.docPartsCount))) {
+		failed(fullId);
+		return SendResult::Failed;
+	}
+	const auto todc = chooseDc();
+	mtpRequestId requestId;
+	if (uploadingData.docSize > kUseBigFilesFrom) {
+		requestId = _api->request(MTPupload_SaveBigFilePart(
+			MTP_long(uploadingData.id()),
+			MTP_int(uploadingData.docSentParts),
+			MTP_int(uploadingData.docPartsCount),
+			MTP_bytes(toSend)
+		)).done([=](const MTPBool &result, mtpRequestId requestId) {
+			partLoaded(result, requestId);
+		}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
+			partFailed(error, requestId);
+		}).toDC(MTP::uploadDcId(todc)).send();
+	} else {
+		requestId = _api->request(MTPupload_SaveFilePart(
+			MTP_long(uploadingData.id()),
+			MTP_int(uploadingData.docSentParts),
+			MTP_bytes(toSend)
+		)).done([=](const MTPBool &result, mtpRequestId requestId) {
+			partLoaded(result, requestId);
+		}).fail([=](const MTP::Error &error, mtpRequestId requestId) {
+			partFailed(error, requestId);
+		}).toDC(MTP::uploadDcId(todc)).send();
+	}
+	_requests.emplace(requestId, Request{
+		.fullId = fullId,
+		.dc = todc,
+		.size = uploadingData.docPartSize,
+		.docPart = true,
+	});
+	sentSize += uploadingData.docPartSize;
+	sentSizes[todc] += uploadingData.docPartSize;
+	++uploadingData.docRequestsSent;
+	uploadingData.started = true;
+
+	uploadingData.docSentParts++;
+	return SendResult::Sent;
+}
+
+void Uploader::readNextParts(const FullMsgId &fullId, File &file) {
+	if (file.docReading) {
+		return;
+	}
+	const auto ahead = std::max(int(kReadAheadSize / file.docPartSize), 1);
+	const auto count = std::min(
+		ahead - int(file.docReadParts.size()),
+		file.docPartsCount - file.docPartsRead);
+	if (count <= 0) {
+		return;
+	}
+	if (!file.docFile) {
+		file.docFile = std::make_shared<QFile>(file.file
+			? file.file->filepath
+			: file.media.file);
+	}
+	file.docReading = true;
+
+	const auto docFile = file.docFile;
+	const auto partSize = file.docPartSize;
+	crl::async([=, weak = base::make_weak(this)] {
+		auto parts = std::vector<QByteArray>();
+		const auto error = !docFile->isOpen()
+			&& !docFile->open(QIODevice::ReadOnly);
+		if (!error) {
+			parts.reserve(count);
+			for (auto i = 0; i != count; ++i) {
+				parts.push_back(docFile->read(partSize));
+			}
+		}
+		crl::on_main(weak, [=, parts = std::move(parts)]() mutable {
+			partsRead(fullId, docFile, std::move(parts), error);
+		});
+	});
+}
+
+void Uploader::partsRead(
+		const FullMsgId &fullId,
+		const std::shared_ptr<QFile> &docFile,
+		std::vector<QByteArray> &&parts,
+		bool error) {
+	const auto i = queue.find(fullId);
+	if (i == queue.end() || i->second.docFile != docFile) {
+		return;
+	} else if (error) {
+		failed(fullId);
+		sendNext();
+		return;
+	}
+	auto &file = i->second;
+	file.docReading = false;
+	file.docPartsRead += int(parts.size());
+	for (auto &part : parts) {
+		file.docReadParts.push_back(std::move(part));
+	}
+	sendNext();
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
-	if (uploadingId == msgId) {
-		currentFailed();
+	const auto i = queue.find(msgId);
+	if (i == queue.end()) {
+		return;
+	} else if (i->second.started) {
+		failed(msgId);
+		sendNext();
 	} else {
-		queue.erase(msgId);
+		queue.erase(i);
 	}
 }
 
 void Uploader::cancelAll() {
-	const auto single = queue.empty() ? uploadingId : queue.begin()->first;
-	if (!single) {
+	if (queue.empty()) {
 		return;
 	}
-	_pausedId = single;
-	if (uploadingId) {
-		currentFailed();
-	}
+	_pausedId = queue.begin()->first;
+	cancelRequests();
 	while (!queue.empty()) {
 		const auto [msgId, file] = std::move(*queue.begin());
 		queue.erase(queue.begin());
@@ -669,60 +791,60 @@ void Uploader::confirm(const FullMsgId &msgId) {
 }
 
 void Uploader::cancelRequests() {
-	for (const auto &requestData : requestsSent) {
-		_api->request(requestData.first).cancel();
+	for (const auto &[requestId, request] : _requests) {
+		_api->request(requestId).cancel();
 	}
-	requestsSent.clear();
-	for (const auto &requestData : docRequestsSent) {
-		_api->request(requestData.first).cancel();
+	_requests.clear();
+	sentSize = 0;
+	for (auto &size : sentSizes) {
+		size = 0;
+	}
+}
+
+void Uploader::cancelRequests(const FullMsgId &fullId) {
+	for (auto i = begin(_requests); i != end(_requests);) {
+		const auto &[requestId, request] = *i;
+		if (request.fullId == fullId) {
+			_api->request(requestId).cancel();
+			sentSize -= request.size;
+			sentSizes[request.dc] -= request.size;
+			i = _requests.erase(i);
+		} else {
+			++i;
+		}
 	}
-	docRequestsSent.clear();
 }
 
 void Uploader::clear() {
 	queue.clear();
 	cancelRequests();
-	dcMap.clear();
-	sentSize = 0;
 	for (int i = 0; i < cNetUploadSessionsCount(); ++i) {
 		_api->instance().stopSession(MTP::uploadDcId(i));
-		sentSizes[i] = 0;
 	}
 	_stopSessionsTimer.cancel();
 }
 
 void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
-	auto j = docRequestsSent.end();
-	auto i = requestsSent.find(requestId);
-	if (i == requestsSent.cend()) {
-		j = docRequestsSent.find(requestId);
-	}
-	if (i != requestsSent.cend() || j != docRequestsSent.cend()) {
-		if (mtpIsFalse(result)) { // failed to upload current file
-			currentFailed();
-			return;
+	const auto i = _requests.find(requestId);
+	if (i != _requests.end()) {
+		const auto request = i->second;
+		_requests.erase(i);
+		sentSize -= request.size;
+		sentSizes[request.dc] -= request.size;
+
+		const auto k = queue.find(request.fullId);
+		if (k == queue.end()) {
+			// The file was already canceled.
+		} else if (mtpIsFalse(result)) { // failed to upload this file
+			failed(request.fullId);
 		} else {
-			auto dcIt = dcMap.find(requestId);
-			if (dcIt == dcMap.cend()) { // must not happen
-				currentFailed();
-				return;
-			}
-			auto dc = dcIt->second;
-			dcMap.erase(dcIt);
-
-			int64 sentPartSize = 0;
-			auto k = queue.find(uploadingId);
-			Assert(k != queue.cend());
 			auto &[fullId, file] = *k;
-			if (i != requestsSent.cend()) {
-				sentPartSize = i->second.size();
-				requestsSent.erase(i);
+			if (request.docPart) {
+				--file.docRequestsSent;
 			} else {
-				sentPartSize = file.docPartSize;
-				docRequestsSent.erase(j);
+				--file.requestsSent;
 			}
-			sentSize -= sentPartSize;
-			sentSizes[dc] -= sentPartSize;
+			const auto sentPartSize = request.size;
 			if (file.type() == SendMediaType::Photo) {
 				file.fileSentSize += sentPartSize;
 				const auto photo = session().data().photo(file.id());
@@ -737,7 +859,7 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 				const auto document = session().data().document(file.id());
 				if (document->uploading()) {
 					const auto doneParts = file.docSentParts
-						- int(docRequestsSent.size());
+						- file.docRequestsSent;
 					document->uploadingData->offset = std::min(
 						document->uploadingData->size,
 						doneParts * file.docPartSize);
@@ -757,10 +879,9 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 }
 
 void Uploader::partFailed(const MTP::Error &error, mtpRequestId requestId) {
-	// failed to upload current file
-	if ((requestsSent.find(requestId) != requestsSent.cend())
-		|| (docRequestsSent.find(requestId) != docRequestsSent.cend())) {
-		currentFailed();
+	// failed to upload this file
+	if (const auto i = _requests.find(requestId); i != _requests.end()) {
+		failed(i->second.fullId);
 	}
 	sendNext();
 }
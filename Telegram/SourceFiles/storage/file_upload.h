@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "api/api_common.h"
 #include "base/timer.h"
+#include "base/weak_ptr.h"
 #include "mtproto/facade.h"
 
 class ApiWrap;
@@ -47,15 +48,18 @@ struct UploadSecureDone {
 	int partsCount = 0;
 };
 
-class Uploader final : public QObject {
+class Uploader final : public QObject, public base::has_weak_ptr {
 public:
 	explicit Uploader(not_null<ApiWrap*> api);
 	~Uploader();
 
 	[[nodiscard]] Main::Session &session() const;
 
-	[[nodiscard]] FullMsgId currentUploadId() const {
-		return uploadingId;
+	[[nodiscard]] bool hasUploads() const {
+		return !queue.empty();
+	}
+	[[nodiscard]] FullMsgId firstUploadId() const {
+		return queue.empty() ? FullMsgId() : queue.begin()->first;
 	}
 
 	void uploadMedia(const FullMsgId &msgId, const SendMediaReady &image);
@@ -104,6 +108,29 @@ public:
 
 private:
 	struct File;
+	struct Request {
+		FullMsgId fullId;
+		int dc = 0;
+		int64 size = 0;
+		bool docPart = false;
+	};
+	enum class SendResult {
+		Sent,
+		Waiting,
+		Failed,
+	};
+
+	void finishUploaded();
+	void fileReady(const FullMsgId &fullId, File &file);
+	bool sendNextPart();
+	[[nodiscard]] SendResult sendPart(const FullMsgId &fullId, File &file);
+	[[nodiscard]] int chooseDc() const;
+	void readNextParts(const FullMsgId &fullId, File &file);
+	void partsRead(
+		const FullMsgId &fullId,
+		const std::shared_ptr<QFile> &docFile,
+		std::vector<QByteArray> &&parts,
+		bool error);
 
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	void partFailed(const MTP::Error &error, mtpRequestId requestId);
@@ -114,8 +141,9 @@ private:
 	void processDocumentFailed(const FullMsgId &msgId);
 
 	void notifyFailed(FullMsgId id, const File &file);
-	void currentFailed();
+	void failed(const FullMsgId &fullId);
 	void cancelRequests();
+	void cancelRequests(const FullMsgId &fullId);
 
 	void sendProgressUpdate(
 		not_null<HistoryItem*> item,
@@ -123,13 +151,10 @@ private:
 		int progress = 0);
 
 	const not_null<ApiWrap*> _api;
-	base::flat_map<mtpRequestId, QByteArray> requestsSent;
-	base::flat_map<mtpRequestId, int32> docRequestsSent;
-	base::flat_map<mtpRequestId, int32> dcMap;
+	base::flat_map<mtpRequestId, Request> _requests;
 	uint32 sentSize = 0; // FileSize: Right now any file size fits 32 bit.
 	uint32 sentSizes[MTP::kUploadSessionsCountMax] = { 0 };
 
-	FullMsgId uploadingId;
 	FullMsgId _pausedId;
 	std::map<FullMsgId, File> queue;
 	base::Timer _nextTimer, _stopSessionsTimer;
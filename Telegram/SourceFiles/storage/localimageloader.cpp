@@ -257,7 +257,8 @@ SendMediaReady::SendMediaReady(
 	}
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int threadsCount)
+: _threadsCount(std::max(threadsCount, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -268,10 +269,17 @@ TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
 
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
+	{
+		QMutexLocker lock(&_tasksToFinishMutex);
+		_tasksOrder.push_back(result);
+	}
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		_tasksToProcess.push_back(std::move(task));
 	}
+	if (!_batchTasks++) {
+		_batchStarted = crl::now();
+	}
 
 	wakeThread();
 
@@ -279,27 +287,44 @@ TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 }
 
 void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
+	{
+		QMutexLocker lock(&_tasksToFinishMutex);
+		for (const auto &task : tasks) {
+			_tasksOrder.push_back(task->id());
+		}
+	}
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		for (auto &task : tasks) {
 			_tasksToProcess.push_back(std::move(task));
 		}
 	}
+	if (!_batchTasks) {
+		_batchStarted = crl::now();
+	}
+	_batchTasks += int(tasks.size());
 
 	wakeThread();
 }
 
 void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+	const auto wanted = [&] {
+		QMutexLocker lock(&_tasksToProcessMutex);
+		return std::min(
+			_threadsCount,
+			int(_tasksToProcess.size() + _tasksInProcess.size()));
+	}();
+	while (int(_workers.size()) < std::max(wanted, 1)) {
+		auto &entry = _workers.emplace_back();
+		entry.thread = new QThread();
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+		entry.worker = new TaskQueueWorker(this);
+		entry.worker->moveToThread(entry.thread);
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+		connect(this, SIGNAL(taskAdded()), entry.worker, SLOT(onTaskAdded()));
+		connect(entry.worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+		entry.thread->start();
 	}
 	if (_stopTimer) _stopTimer->stop();
 	taskAdded();
@@ -318,12 +343,27 @@ void TaskQueue::cancelTask(TaskId id) {
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
-		}
+		_tasksInProcess.erase(
+			ranges::remove(_tasksInProcess, id),
+			end(_tasksInProcess));
 	}
 	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
+	_tasksToFinish.remove(id);
+	const auto i = ranges::find(_tasksOrder, id);
+	if (i == end(_tasksOrder)) {
+		return;
+	}
+	const auto wasFirst = (i == begin(_tasksOrder));
+	_tasksOrder.erase(i);
+	if (wasFirst
+		&& !_tasksOrder.empty()
+		&& _tasksToFinish.contains(_tasksOrder.front())) {
+		// The next task was waiting only for the canceled one.
+		QMetaObject::invokeMethod(
+			this,
+			"onTaskProcessed",
+			Qt::QueuedConnection);
+	}
 }
 
 void TaskQueue::onTaskProcessed() {
@@ -331,33 +371,62 @@ void TaskQueue::onTaskProcessed() {
 		auto task = std::unique_ptr<Task>();
 		{
 			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			if (_tasksOrder.empty()) break;
+			const auto i = _tasksToFinish.find(_tasksOrder.front());
+			if (i == end(_tasksToFinish)) break;
+			task = std::move(i->second);
+			_tasksToFinish.erase(i);
+			_tasksOrder.pop_front();
 		}
 		task->finish();
 	} while (true);
 
+	{
+		QMutexLocker lock(&_tasksToFinishMutex);
+		if (!_tasksOrder.empty()) {
+			return;
+		}
+	}
+	logBatchFinished();
+
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
+void TaskQueue::logBatchFinished() {
+	if (!_batchTasks) {
+		return;
+	}
+	DEBUG_LOG(("Task Queue: %1 tasks processed in %2 ms by %3 threads."
+		).arg(_batchTasks
+		).arg(crl::now() - _batchStarted
+		).arg(_workers.size()));
+	_batchTasks = 0;
+	_batchStarted = 0;
+}
+
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	for (const auto &entry : _workers) {
+		entry.thread->requestInterruption();
+		entry.thread->quit();
+	}
+	if (!_workers.empty()) {
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+	}
+	for (auto &entry : base::take(_workers)) {
+		entry.thread->wait();
+		delete entry.worker;
+		delete entry.thread;
 	}
 	_tasksToProcess.clear();
+	_tasksInProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasksOrder.clear();
+	_batchTasks = 0;
 }
 
 TaskQueue::~TaskQueue() {
@@ -377,7 +446,7 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.push_back(task->id());
 			}
 		}
 
@@ -386,14 +455,20 @@ void TaskQueueWorker::onTaskAdded() {
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
+				auto &inProcess = _queue->_tasksInProcess;
+				const auto i = ranges::find(inProcess, task->id());
+				if (i != end(inProcess)) {
+					inProcess.erase(i);
 
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+					const auto &order = _queue->_tasksOrder;
+					emitTaskProcessed = !order.empty()
+						&& (order.front() == task->id());
+					_queue->_tasksToFinish.emplace(
+						task->id(),
+						std::move(task));
 				}
+				someTasksLeft = !_queue->_tasksToProcess.empty();
 			}
 			if (emitTaskProcessed) {
 				taskProcessed();
@@ -708,6 +783,13 @@ bool FileLoadTask::FillImageInformation(
 }
 
 void FileLoadTask::process(Args &&args) {
+	const auto started = crl::now();
+	auto stageStarted = started;
+	const auto finishStage = [&] {
+		const auto now = crl::now();
+		return now - std::exchange(stageStarted, now);
+	};
+
 	_result = std::make_shared<FileLoadResult>(
 		id(),
 		_id,
@@ -830,6 +912,7 @@ void FileLoadTask::process(Args &&args) {
 	if (!filesize || filesize > kFileSizePremiumLimit) {
 		return;
 	}
+	const auto readDuration = finishStage();
 
 	PreparedPhotoThumbs photoThumbs;
 	QVector<MTPPhotoSize> photoSizes;
@@ -895,6 +978,8 @@ void FileLoadTask::process(Args &&args) {
 		}
 	}
 
+	const auto mediaDuration = finishStage();
+
 	if (!fullimage.isNull() && fullimage.width() > 0 && !isSong && !isVideo && !isVoice) {
 		auto w = fullimage.width(), h = fullimage.height();
 		attributes.push_back(MTP_documentAttributeImageSize(MTP_int(w), MTP_int(h)));
@@ -966,6 +1051,7 @@ void FileLoadTask::process(Args &&args) {
 		filemime,
 		filesize,
 		isSticker);
+	const auto imageDuration = finishStage();
 
 	if (_type == SendMediaType::Photo && photoThumbs.empty()) {
 		_type = SendMediaType::File;
@@ -1035,6 +1121,16 @@ void FileLoadTask::process(Args &&args) {
 	_result->photo = photo;
 	_result->document = document;
 	_result->photoThumbs = photoThumbs;
+
+	const auto partsDuration = finishStage();
+	DEBUG_LOG(("File Load Task: '%1' prepared in %2 ms "
+		"(read %3, media %4, image %5, parts %6)."
+		).arg(filename
+		).arg(crl::now() - started
+		).arg(readDuration
+		).arg(mediaDuration
+		).arg(imageDuration
+		).arg(partsDuration));
 }
 
 void FileLoadTask::finish() {
@@ -91,7 +91,10 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	// <= 0 - never stop workers.
+	// Tasks are processed by up to threadsCount workers in parallel,
+	// but finish() is always called in the order the tasks were added.
+	explicit TaskQueue(crl::time stopTimeoutMs = 0, int threadsCount = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -109,16 +112,26 @@ public Q_SLOTS:
 private:
 	friend class TaskQueueWorker;
 
+	struct Worker {
+		QThread *thread = nullptr;
+		TaskQueueWorker *worker = nullptr;
+	};
+
 	void wakeThread();
+	void logBatchFinished();
 
+	const int _threadsCount = 1;
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
+	std::vector<TaskId> _tasksInProcess;
+	std::deque<TaskId> _tasksOrder;
+	base::flat_map<TaskId, std::unique_ptr<Task>> _tasksToFinish;
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	std::vector<Worker> _workers;
 	QTimer *_stopTimer = nullptr;
 
+	crl::time _batchStarted = 0;
+	int _batchTasks = 0;
+
 };
 
 class TaskQueueWorker : public QObject {
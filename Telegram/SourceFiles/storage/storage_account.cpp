@@ -11,8 +11,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_domain.h"
 #include "storage/storage_encryption.h"
 #include "storage/storage_clear_legacy.h"
+#include "storage/storage_facade.h"
+#include "storage/storage_shared_media.h"
 #include "storage/cache/storage_cache_types.h"
 #include "storage/details/storage_file_utilities.h"
+#include "storage/details/storage_journal.h"
 #include "storage/details/storage_settings_scheme.h"
 #include "storage/serialize_common.h"
 #include "storage/serialize_peer.h"
@@ -41,6 +44,10 @@ using namespace details;
 using Database = Cache::Database;
 
 constexpr auto kDelayedWriteTimeout = crl::time(1000);
+constexpr auto kSearchIndexWriteTimeout = 10 * crl::time(1000);
+
+constexpr auto kJournalDrafts = quint32(1);
+constexpr auto kJournalDraftCursors = quint32(2);
 
 constexpr auto kStickersVersionTag = quint32(-1);
 constexpr auto kStickersSerializeVersion = 3;
@@ -85,6 +92,8 @@ enum { // Local Storage Keys
 	lskSelfSerialized = 0x15, // serialized self
 	lskMasksKeys = 0x16, // no data
 	lskCustomEmojiKeys = 0x17, // no data
+	lskSharedMedia = 0x18, // data: PeerId peer
+	lskSearchIndex = 0x19, // no data
 };
 
 auto EmptyMessageDraftSources()
@@ -121,6 +130,17 @@ auto EmptyMessageDraftSources()
 	return cWorkingDir() + u"tdata/tdld/"_q;
 }
 
+[[nodiscard]] QByteArray EncryptSearchIndex(
+		const QByteArray &serialized,
+		const MTP::AuthKeyPtr &key) {
+	if (serialized.isEmpty()) {
+		return QByteArray();
+	}
+	EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+	data.stream << serialized;
+	return PrepareEncrypted(data, key);
+}
+
 } // namespace
 
 Account::Account(not_null<Main::Account*> owner, const QString &dataName)
@@ -135,10 +155,26 @@ Account::Account(not_null<Main::Account*> owner, const QString &dataName)
 , _cacheTotalTimeLimit(Database::Settings().totalTimeLimit)
 , _cacheBigFileTotalTimeLimit(Database::Settings().totalTimeLimit)
 , _writeMapTimer([=] { writeMap(); })
-, _writeLocationsTimer([=] { writeLocations(); }) {
+, _writeLocationsTimer([=] { writeLocations(); })
+, _writeSharedMediaTimer([=] { writeSharedMedia(); })
+, _writeSearchIndexTimer([=] { writeSearchIndex(); }) {
 }
 
 Account::~Account() {
+	if (_localKey) {
+		// Write the last index state right away, even if it is being
+		// prepared on the background queue, that result won't arrive.
+		if (_writeSearchIndexTimer.isActive()) {
+			const auto snapshot = base::take(_searchIndexSnapshot);
+			if (auto serialize = snapshot ? snapshot() : nullptr) {
+				_searchIndexWriting = std::move(serialize);
+			}
+		}
+		if (const auto serialize = base::take(_searchIndexWriting)) {
+			writeSearchIndexEncrypted(
+				EncryptSearchIndex(serialize(), _localKey));
+		}
+	}
 	if (_localKey && _mapChanged) {
 		writeMap();
 	}
@@ -168,6 +204,14 @@ std::unique_ptr<MTP::Config> Account::start(MTP::AuthKeyPtr localKey) {
 	return readMtpConfig();
 }
 
+std::vector<FileToRead> Account::startFiles() const {
+	return {
+		{ u"map"_q, _basePath },
+		{ u"config"_q, _basePath },
+		{ ToFilePart(_dataNameKey), BaseGlobalPath() },
+	};
+}
+
 void Account::startAdded(MTP::AuthKeyPtr localKey) {
 	Expects(localKey != nullptr);
 
@@ -200,6 +244,7 @@ base::flat_set<QString> Account::collectGoodNames() const {
 		_legacyBackgroundKeyDay,
 		_recentHashtagsAndBotsKey,
 		_exportSettingsKey,
+		_searchIndexKey,
 		_trustedBotsKey,
 		_installedMasksKey,
 		_recentMasksKey,
@@ -213,6 +258,8 @@ base::flat_set<QString> Account::collectGoodNames() const {
 		"map1",
 		"maps",
 		"configs",
+		"journal",
+		"shared_media",
 	};
 	const auto push = [&](FileKey key) {
 		if (!key) {
@@ -284,6 +331,7 @@ Account::ReadMapResult Account::readMapWith(
 	base::flat_map<PeerId, FileKey> draftsMap;
 	base::flat_map<PeerId, FileKey> draftCursorsMap;
 	base::flat_map<PeerId, bool> draftsNotReadMap;
+	auto hadSharedMediaFiles = false;
 	quint64 locationsKey = 0, reportSpamStatusesKey = 0, trustedBotsKey = 0;
 	quint64 recentStickersKeyOld = 0;
 	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
@@ -292,6 +340,7 @@ Account::ReadMapResult Account::readMapWith(
 	quint64 savedGifsKey = 0;
 	quint64 legacyBackgroundKeyDay = 0, legacyBackgroundKeyNight = 0;
 	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
+	quint64 searchIndexKey = 0;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -311,6 +360,18 @@ Account::ReadMapResult Account::readMapWith(
 		case lskSelfSerialized: {
 			map.stream >> selfSerialized;
 		} break;
+		case lskSharedMedia: {
+			// Shared media lists are in the journal now,
+			// the files are cleared with the other unknown ones.
+			quint32 count = 0;
+			map.stream >> count;
+			for (quint32 i = 0; i < count; ++i) {
+				FileKey key;
+				quint64 peerIdSerialized;
+				map.stream >> key >> peerIdSerialized;
+			}
+			hadSharedMediaFiles = true;
+		} break;
 		case lskDraftPosition: {
 			quint32 count = 0;
 			map.stream >> count;
@@ -385,6 +446,9 @@ Account::ReadMapResult Account::readMapWith(
 		case lskExportSettings: {
 			map.stream >> exportSettingsKey;
 		} break;
+		case lskSearchIndex: {
+			map.stream >> searchIndexKey;
+		} break;
 		case lskMasksKeys: {
 			map.stream
 				>> installedMasksKey
@@ -411,6 +475,9 @@ Account::ReadMapResult Account::readMapWith(
 	_draftsMap = draftsMap;
 	_draftCursorsMap = draftCursorsMap;
 	_draftsNotReadMap = draftsNotReadMap;
+	for (const auto id : journal().ids(kJournalDrafts)) {
+		_draftsNotReadMap.emplace(DeserializePeerId(id), true);
+	}
 
 	_locationsKey = locationsKey;
 	_trustedBotsKey = trustedBotsKey;
@@ -432,9 +499,10 @@ Account::ReadMapResult Account::readMapWith(
 	_settingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
+	_searchIndexKey = searchIndexKey;
 	_oldMapVersion = mapData.version;
 
-	if (_oldMapVersion < AppVersion) {
+	if (_oldMapVersion < AppVersion || hadSharedMediaFiles) {
 		writeMapDelayed();
 	} else {
 		_mapChanged = false;
@@ -531,6 +599,7 @@ void Account::writeMap() {
 	if (_settingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_exportSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_searchIndexKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_installedMasksKey || _recentMasksKey || _archivedMasksKey) {
 		mapSize += sizeof(quint32) + 3 * sizeof(quint64);
 	}
@@ -582,6 +651,9 @@ void Account::writeMap() {
 	if (_exportSettingsKey) {
 		mapData.stream << quint32(lskExportSettings) << quint64(_exportSettingsKey);
 	}
+	if (_searchIndexKey) {
+		mapData.stream << quint32(lskSearchIndex) << quint64(_searchIndexKey);
+	}
 	if (_installedMasksKey || _recentMasksKey || _archivedMasksKey) {
 		mapData.stream << quint32(lskMasksKeys);
 		mapData.stream
@@ -606,6 +678,16 @@ void Account::reset() {
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
 	_draftsNotReadMap.clear();
+	if (_journal) {
+		_journal->clear();
+	}
+	if (_sharedMediaJournal) {
+		_sharedMediaJournal->with([](QueuedJournal &journal) {
+			journal.clear();
+		});
+	}
+	_sharedMediaChanged.clear();
+	_writeSharedMediaTimer.cancel();
 	_locationsKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = 0;
@@ -622,6 +704,11 @@ void Account::reset() {
 	_archivedCustomEmojiKey = 0;
 	_legacyBackgroundKeyDay = _legacyBackgroundKeyNight = 0;
 	_settingsKey = _recentHashtagsAndBotsKey = _exportSettingsKey = 0;
+	_searchIndexKey = 0;
+	_searchIndexSnapshot = nullptr;
+	_searchIndexWriting = nullptr;
+	_searchIndexResetId = _searchIndexWriteId;
+	_writeSearchIndexTimer.cancel();
 	_oldMapVersion = 0;
 	_fileLocations.clear();
 	_fileLocationPairs.clear();
@@ -743,6 +830,68 @@ void Account::writeLocationsDelayed() {
 	_writeLocationsTimer.callOnce(kDelayedWriteTimeout);
 }
 
+void Account::writeSharedMediaDelayed(
+		PeerId peerId,
+		SharedMediaType type) {
+	_sharedMediaChanged.emplace(peerId, type);
+	_writeSharedMediaTimer.callOnce(kDelayedWriteTimeout);
+}
+
+void Account::writeSharedMedia() {
+	_writeSharedMediaTimer.cancel();
+	if (!_localKey || !_owner->sessionExists()) {
+		_sharedMediaChanged.clear();
+		return;
+	}
+	const auto changed = base::take(_sharedMediaChanged);
+	const auto &storage = _owner->session().storage();
+	auto values = std::vector<std::pair<QueuedJournal::Key, QByteArray>>();
+	values.reserve(changed.size());
+	for (const auto &[peerId, type] : changed) {
+		values.emplace_back(
+			QueuedJournal::Key{
+				quint32(type),
+				SerializePeerId(peerId),
+			},
+			storage.sharedMediaSerialized(peerId, type));
+	}
+	sharedMediaJournal().with([values = std::move(values)](
+			QueuedJournal &journal) mutable {
+		journal.write(std::move(values));
+	});
+	DEBUG_LOG(("Shared Media: Writing %1 changed lists."
+		).arg(changed.size()));
+}
+
+void Account::readSharedMedia(
+		PeerId peerId,
+		Fn<void(std::vector<QByteArray>&&)> done) {
+	Expects(_localKey != nullptr);
+
+	auto keys = std::vector<QueuedJournal::Key>();
+	keys.reserve(kSharedMediaTypeCount);
+	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+		keys.push_back({ quint32(index), SerializePeerId(peerId) });
+	}
+	sharedMediaJournal().with([
+		keys = std::move(keys),
+		done = std::move(done)
+	](QueuedJournal &journal) mutable {
+		journal.read(std::move(keys), std::move(done));
+	});
+}
+
+auto Account::sharedMediaJournal()
+-> crl::object_on_queue<QueuedJournal>& {
+	if (!_sharedMediaJournal) {
+		_sharedMediaJournal = std::make_unique<
+			crl::object_on_queue<QueuedJournal>>(
+				_basePath + u"shared_media"_q,
+				_localKey);
+	}
+	return *_sharedMediaJournal;
+}
+
 void Account::readLocations() {
 	FileReadDescriptor locations;
 	if (!ReadEncryptedFile(locations, _locationsKey, _basePath, _localKey)) {
@@ -817,6 +966,70 @@ QByteArray Account::downloadsSerialized() const {
 	return _downloadsSerialized;
 }
 
+void Account::updateSearchIndex(
+		Fn<Fn<QByteArray()>()> searchIndexSnapshot) {
+	_searchIndexSnapshot = std::move(searchIndexSnapshot);
+	if (!_writeSearchIndexTimer.isActive()) {
+		_writeSearchIndexTimer.callOnce(kSearchIndexWriteTimeout);
+	}
+}
+
+void Account::writeSearchIndex() {
+	_writeSearchIndexTimer.cancel();
+	const auto snapshot = base::take(_searchIndexSnapshot);
+	auto serialize = snapshot ? snapshot() : nullptr;
+	if (!serialize) {
+		return;
+	}
+	const auto id = ++_searchIndexWriteId;
+	const auto weak = base::make_weak(_owner);
+	_searchIndexWriting = serialize;
+	_searchIndexQueue.async([=, key = _localKey] {
+		auto encrypted = EncryptSearchIndex(serialize(), key);
+		crl::on_main(weak, [=, encrypted = std::move(encrypted)] {
+			if (id <= _searchIndexResetId) {
+				return;
+			} else if (id == _searchIndexWriteId) {
+				_searchIndexWriting = nullptr;
+			}
+			writeSearchIndexEncrypted(encrypted);
+		});
+	});
+}
+
+void Account::writeSearchIndexEncrypted(const QByteArray &encrypted) {
+	if (encrypted.isEmpty()) {
+		if (_searchIndexKey) {
+			ClearKey(_searchIndexKey, _basePath);
+			_searchIndexKey = 0;
+			writeMapDelayed();
+		}
+		return;
+	}
+	if (!_searchIndexKey) {
+		_searchIndexKey = GenerateKey(_basePath);
+		writeMapQueued();
+	}
+	FileWriteDescriptor file(_searchIndexKey, _basePath);
+	file.writeData(encrypted);
+}
+
+QByteArray Account::readSearchIndex() {
+	if (!_searchIndexKey) {
+		return QByteArray();
+	}
+	FileReadDescriptor file;
+	if (!ReadEncryptedFile(file, _searchIndexKey, _basePath, _localKey)) {
+		ClearKey(_searchIndexKey, _basePath);
+		_searchIndexKey = 0;
+		writeMapDelayed();
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	file.stream >> result;
+	return CheckStreamStatus(file.stream) ? result : QByteArray();
+}
+
 void Account::writeSessionSettings() {
 	writeSessionSettings(nullptr);
 }
@@ -1099,23 +1312,11 @@ void Account::writeDrafts(not_null<History*> history) {
 		sources,
 		[&](auto&&...) { ++count; });
 	if (!count) {
-		auto i = _draftsMap.find(peerId);
-		if (i != _draftsMap.cend()) {
-			ClearKey(i->second, _basePath);
-			_draftsMap.erase(i);
-			writeMapDelayed();
-		}
-
+		clearPeerRecord(kJournalDrafts, peerId, _draftsMap);
 		_draftsNotReadMap.remove(peerId);
 		return;
 	}
 
-	auto i = _draftsMap.find(peerId);
-	if (i == _draftsMap.cend()) {
-		i = _draftsMap.emplace(peerId, GenerateKey(_basePath)).first;
-		writeMapQueued();
-	}
-
 	auto size = int(sizeof(quint64) * 2 + sizeof(quint32));
 	const auto sizeCallback = [&](
 			auto&&, // key
@@ -1159,8 +1360,7 @@ void Account::writeDrafts(not_null<History*> history) {
 		sources,
 		writeCallback);
 
-	FileWriteDescriptor file(i->second, _basePath);
-	file.writeEncrypted(data, _localKey);
+	writePeerRecord(kJournalDrafts, peerId, _draftsMap, data);
 
 	_draftsNotReadMap.remove(peerId);
 }
@@ -1183,11 +1383,6 @@ void Account::writeDraftCursors(not_null<History*> history) {
 		clearDraftCursors(peerId);
 		return;
 	}
-	auto i = _draftCursorsMap.find(peerId);
-	if (i == _draftCursorsMap.cend()) {
-		i = _draftCursorsMap.emplace(peerId, GenerateKey(_basePath)).first;
-		writeMapQueued();
-	}
 
 	auto size = int(sizeof(quint64) * 2
 		+ sizeof(quint32)
@@ -1217,27 +1412,68 @@ void Account::writeDraftCursors(not_null<History*> history) {
 		sources,
 		writeCallback);
 
-	FileWriteDescriptor file(i->second, _basePath);
-	file.writeEncrypted(data, _localKey);
+	writePeerRecord(kJournalDraftCursors, peerId, _draftCursorsMap, data);
 }
 
 void Account::clearDraftCursors(PeerId peerId) {
-	const auto i = _draftCursorsMap.find(peerId);
-	if (i != _draftCursorsMap.cend()) {
+	clearPeerRecord(kJournalDraftCursors, peerId, _draftCursorsMap);
+}
+
+Journal &Account::journal() {
+	if (!_journal) {
+		_journal = std::make_unique<Journal>(
+			_basePath + u"journal"_q,
+			_localKey);
+	}
+	return *_journal;
+}
+
+bool Account::readPeerRecord(
+		FileReadDescriptor &result,
+		quint32 type,
+		PeerId peerId,
+		const base::flat_map<PeerId, FileKey> &files) {
+	const auto key = Journal::Key{ type, SerializePeerId(peerId) };
+	if (journal().contains(key)) {
+		return ReadEncryptedData(result, journal().value(key), _localKey);
+	}
+	const auto i = files.find(peerId);
+	return (i != end(files))
+		&& ReadEncryptedFile(result, i->second, _basePath, _localKey);
+}
+
+void Account::writePeerRecord(
+		quint32 type,
+		PeerId peerId,
+		base::flat_map<PeerId, FileKey> &files,
+		EncryptedDescriptor &data) {
+	// The file written by an older version is replaced by the record.
+	if (const auto i = files.find(peerId); i != end(files)) {
 		ClearKey(i->second, _basePath);
-		_draftCursorsMap.erase(i);
+		files.erase(i);
 		writeMapDelayed();
 	}
+	journal().write(
+		{ type, SerializePeerId(peerId) },
+		PrepareEncrypted(data, _localKey));
 }
 
-void Account::readDraftCursors(PeerId peerId, Data::HistoryDrafts &map) {
-	const auto j = _draftCursorsMap.find(peerId);
-	if (j == _draftCursorsMap.cend()) {
-		return;
+void Account::clearPeerRecord(
+		quint32 type,
+		PeerId peerId,
+		base::flat_map<PeerId, FileKey> &files) {
+	if (const auto i = files.find(peerId); i != end(files)) {
+		ClearKey(i->second, _basePath);
+		files.erase(i);
+		writeMapDelayed();
 	}
+	journal().remove({ type, SerializePeerId(peerId) });
+}
 
+void Account::readDraftCursors(PeerId peerId, Data::HistoryDrafts &map) {
 	FileReadDescriptor draft;
-	if (!ReadEncryptedFile(draft, j->second, _basePath, _localKey)) {
+	const auto type = kJournalDraftCursors;
+	if (!readPeerRecord(draft, type, peerId, _draftCursorsMap)) {
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1328,15 +1564,9 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 		return;
 	}
 
-	const auto j = _draftsMap.find(peerId);
-	if (j == _draftsMap.cend()) {
-		clearDraftCursors(peerId);
-		return;
-	}
 	FileReadDescriptor draft;
-	if (!ReadEncryptedFile(draft, j->second, _basePath, _localKey)) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
+	if (!readPeerRecord(draft, kJournalDrafts, peerId, _draftsMap)) {
+		clearPeerRecord(kJournalDrafts, peerId, _draftsMap);
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1352,8 +1582,7 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 	draft.stream >> draftPeerSerialized >> count;
 	const auto draftPeer = DeserializePeerId(draftPeerSerialized);
 	if (!count || count > 1000 || draftPeer != peerId) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
+		clearPeerRecord(kJournalDrafts, peerId, _draftsMap);
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1396,8 +1625,7 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 		}
 	}
 	if (draft.stream.status() != QDataStream::Ok) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
+		clearPeerRecord(kJournalDrafts, peerId, _draftsMap);
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1432,11 +1660,7 @@ void Account::readDraftsWithCursorsLegacy(
 	const auto peerId = history->peer->id;
 	const auto draftPeer = DeserializePeerId(draftPeerSerialized);
 	if (draftPeer != peerId) {
-		const auto j = _draftsMap.find(peerId);
-		if (j != _draftsMap.cend()) {
-			ClearKey(j->second, _basePath);
-			_draftsMap.erase(j);
-		}
+		clearPeerRecord(kJournalDrafts, peerId, _draftsMap);
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1479,11 +1703,13 @@ void Account::readDraftsWithCursorsLegacy(
 }
 
 bool Account::hasDraftCursors(PeerId peer) {
-	return _draftCursorsMap.contains(peer);
+	return _draftCursorsMap.contains(peer)
+		|| journal().contains({ kJournalDraftCursors, SerializePeerId(peer) });
 }
 
 bool Account::hasDraft(PeerId peer) {
-	return _draftsMap.contains(peer);
+	return _draftsMap.contains(peer)
+		|| journal().contains({ kJournalDrafts, SerializePeerId(peer) });
 }
 
 void Account::writeFileLocation(MediaKey location, const Core::FileLocation &local) {
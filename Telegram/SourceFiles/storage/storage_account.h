@@ -13,6 +13,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/stickers/data_stickers_set.h"
 #include "data/data_drafts.h"
 
+#include <crl/crl_object_on_queue.h>
+#include <crl/crl_queue.h>
+
 class History;
 
 namespace Core {
@@ -42,9 +45,14 @@ namespace Storage {
 namespace details {
 struct ReadSettingsContext;
 struct FileReadDescriptor;
+struct FileToRead;
+struct EncryptedDescriptor;
+class Journal;
+class QueuedJournal;
 } // namespace details
 
 class EncryptionKey;
+enum class SharedMediaType : signed char;
 
 using FileKey = quint64;
 
@@ -70,6 +78,7 @@ public:
 	[[nodiscard]] std::unique_ptr<MTP::Config> start(
 		MTP::AuthKeyPtr localKey);
 	void startAdded(MTP::AuthKeyPtr localKey);
+	[[nodiscard]] std::vector<details::FileToRead> startFiles() const;
 	[[nodiscard]] int oldMapVersion() const {
 		return _oldMapVersion;
 	}
@@ -97,6 +106,11 @@ public:
 	[[nodiscard]] bool hasDraftCursors(PeerId peerId);
 	[[nodiscard]] bool hasDraft(PeerId peerId);
 
+	void writeSharedMediaDelayed(PeerId peerId, SharedMediaType type);
+	void readSharedMedia(
+		PeerId peerId,
+		Fn<void(std::vector<QByteArray>&&)> done);
+
 	void writeFileLocation(
 		MediaKey location,
 		const Core::FileLocation &local);
@@ -106,6 +120,11 @@ public:
 	void updateDownloads(Fn<std::optional<QByteArray>()> downloadsSerialize);
 	[[nodiscard]] QByteArray downloadsSerialized() const;
 
+	// The snapshot is taken on main, it is serialized on a background
+	// queue. Null snapshot means there is nothing to write.
+	void updateSearchIndex(Fn<Fn<QByteArray()>()> searchIndexSnapshot);
+	[[nodiscard]] QByteArray readSearchIndex();
+
 	[[nodiscard]] EncryptionKey cacheKey() const;
 	[[nodiscard]] QString cachePath() const;
 	[[nodiscard]] Cache::Database::Settings cacheSettings() const;
@@ -206,6 +225,11 @@ private:
 	void writeLocations();
 	void writeLocationsQueued();
 	void writeLocationsDelayed();
+	void writeSharedMedia();
+	[[nodiscard]] auto sharedMediaJournal()
+	-> crl::object_on_queue<details::QueuedJournal>&;
+	void writeSearchIndex();
+	void writeSearchIndexEncrypted(const QByteArray &encrypted);
 
 	std::unique_ptr<Main::SessionSettings> readSessionSettings();
 	void writeSessionSettings(Main::SessionSettings *stored);
@@ -215,6 +239,22 @@ private:
 	std::unique_ptr<Main::SessionSettings> applyReadContext(
 		details::ReadSettingsContext &&context);
 
+	[[nodiscard]] details::Journal &journal();
+	[[nodiscard]] bool readPeerRecord(
+		details::FileReadDescriptor &result,
+		quint32 type,
+		PeerId peerId,
+		const base::flat_map<PeerId, FileKey> &files);
+	void writePeerRecord(
+		quint32 type,
+		PeerId peerId,
+		base::flat_map<PeerId, FileKey> &files,
+		details::EncryptedDescriptor &data);
+	void clearPeerRecord(
+		quint32 type,
+		PeerId peerId,
+		base::flat_map<PeerId, FileKey> &files);
+
 	void readDraftCursors(PeerId peerId, Data::HistoryDrafts &map);
 	void readDraftCursorsLegacy(
 		PeerId peerId,
@@ -257,9 +297,15 @@ private:
 
 	MTP::AuthKeyPtr _localKey;
 
+	// Drafts and their cursors are kept in the journal,
+	// the maps point to the files written by the older versions.
+	std::unique_ptr<details::Journal> _journal;
 	base::flat_map<PeerId, FileKey> _draftsMap;
 	base::flat_map<PeerId, FileKey> _draftCursorsMap;
 	base::flat_map<PeerId, bool> _draftsNotReadMap;
+	std::unique_ptr<
+		crl::object_on_queue<details::QueuedJournal>> _sharedMediaJournal;
+	base::flat_set<std::pair<PeerId, SharedMediaType>> _sharedMediaChanged;
 	base::flat_map<
 		not_null<History*>,
 		base::flat_map<Data::DraftKey, MessageDraftSource>> _draftSources;
@@ -270,6 +316,11 @@ private:
 
 	QByteArray _downloadsSerialized;
 	Fn<std::optional<QByteArray>()> _downloadsSerialize;
+	Fn<Fn<QByteArray()>()> _searchIndexSnapshot;
+	Fn<QByteArray()> _searchIndexWriting;
+	crl::queue _searchIndexQueue;
+	uint64 _searchIndexWriteId = 0;
+	uint64 _searchIndexResetId = 0;
 
 	FileKey _locationsKey = 0;
 	FileKey _trustedBotsKey = 0;
@@ -286,6 +337,7 @@ private:
 	FileKey _settingsKey = 0;
 	FileKey _recentHashtagsAndBotsKey = 0;
 	FileKey _exportSettingsKey = 0;
+	FileKey _searchIndexKey = 0;
 	FileKey _installedMasksKey = 0;
 	FileKey _recentMasksKey = 0;
 	FileKey _installedCustomEmojiKey = 0;
@@ -306,6 +358,8 @@ private:
 
 	base::Timer _writeMapTimer;
 	base::Timer _writeLocationsTimer;
+	base::Timer _writeSharedMediaTimer;
+	base::Timer _writeSearchIndexTimer;
 	bool _mapChanged = false;
 	bool _locationsChanged = false;
 
@@ -115,6 +115,7 @@ void Domain::encryptLocalKey(const QByteArray &passcode) {
 
 Domain::StartModernResult Domain::startModern(
 		const QByteArray &passcode) {
+	const auto started = crl::now();
 	const auto name = ComputeKeyName(_dataName);
 
 	FileReadDescriptor keyData;
@@ -133,7 +134,10 @@ Domain::StartModernResult Domain::startModern(
 		LOG(("App Error: bad salt in info file, size: %1").arg(salt.size()));
 		return StartModernResult::Failed;
 	}
+	const auto keyStarted = crl::now();
 	_passcodeKey = CreateLocalKey(passcode, salt);
+	LOG(("Startup Info: local key created in %1 ms."
+		).arg(crl::now() - keyStarted));
 
 	EncryptedDescriptor keyInnerData, info;
 	if (!DecryptLocal(keyInnerData, keyEncrypted, _passcodeKey)) {
@@ -167,9 +171,14 @@ Domain::StartModernResult Domain::startModern(
 
 	_oldVersion = keyData.version;
 
+	struct Entry {
+		int position = 0;
+		int index = 0;
+		std::unique_ptr<Main::Account> account;
+	};
 	auto tried = base::flat_set<int>();
-	auto sessions = base::flat_set<uint64>();
-	auto active = 0;
+	auto entries = std::vector<Entry>();
+	auto files = std::vector<FileToRead>();
 	for (auto i = 0; i != count; ++i) {
 		auto index = qint32();
 		info.stream >> index;
@@ -180,23 +189,50 @@ Domain::StartModernResult Domain::startModern(
 				_owner,
 				_dataName,
 				index);
-			auto config = account->prepareToStart(_localKey);
-			const auto sessionId = account->willHaveSessionUniqueId(
-				config.get());
-			if (!sessions.contains(sessionId)
-				&& (sessionId != 0 || (sessions.empty() && i + 1 == count))) {
-				if (sessions.empty()) {
-					active = index;
-				}
-				account->start(std::move(config));
-				_owner->accountAddedInStorage({
-					.index = index,
-					.account = std::move(account)
-				});
-				sessions.emplace(sessionId);
+			auto list = account->local().startFiles();
+			files.insert(
+				end(files),
+				std::make_move_iterator(begin(list)),
+				std::make_move_iterator(end(list)));
+			entries.push_back({ i, index, std::move(account) });
+		}
+	}
+
+	// Accounts are started one by one on the main thread,
+	// but the files they start with are read all at once.
+	const auto prefetchStarted = crl::now();
+	PrefetchFiles(files);
+	LOG(("Startup Info: %1 files of %2 accounts read in %3 ms."
+		).arg(files.size()
+		).arg(entries.size()
+		).arg(crl::now() - prefetchStarted));
+
+	auto sessions = base::flat_set<uint64>();
+	auto active = 0;
+	for (auto &[i, index, account] : entries) {
+		const auto accountStarted = crl::now();
+		auto config = account->prepareToStart(_localKey);
+		const auto sessionId = account->willHaveSessionUniqueId(
+			config.get());
+		if (!sessions.contains(sessionId)
+			&& (sessionId != 0 || (sessions.empty() && i + 1 == count))) {
+			if (sessions.empty()) {
+				active = index;
 			}
+			account->start(std::move(config));
+			_owner->accountAddedInStorage({
+				.index = index,
+				.account = std::move(account)
+			});
+			sessions.emplace(sessionId);
 		}
+		account = nullptr;
+		LOG(("Startup Info: account %1 started in %2 ms."
+			).arg(index
+			).arg(crl::now() - accountStarted));
 	}
+	ClearPrefetched();
+
 	if (sessions.empty()) {
 		LOG(("App Error: no accounts read."));
 		return StartModernResult::Failed;
@@ -205,7 +241,12 @@ Domain::StartModernResult Domain::startModern(
 	if (!info.stream.atEnd()) {
 		info.stream >> active;
 	}
+	const auto activateStarted = crl::now();
 	_owner->activateFromStorage(active);
+	LOG(("Startup Info: account %1 activated in %2 ms, total %3 ms."
+		).arg(active
+		).arg(crl::now() - activateStarted
+		).arg(crl::now() - started));
 
 	Ensures(!sessions.empty());
 	return StartModernResult::Success;
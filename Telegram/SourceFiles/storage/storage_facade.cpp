@@ -21,13 +21,21 @@ public:
 	void remove(SharedMediaRemoveAll &&query);
 	void invalidate(SharedMediaInvalidateBottom &&query);
 	void unload(SharedMediaUnloadThread &&query);
-	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query) const;
-	SharedMediaResult snapshot(const SharedMediaQuery &query) const;
-	bool empty(const SharedMediaKey &key) const;
+	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query);
+	SharedMediaResult snapshot(const SharedMediaQuery &query);
+	bool empty(const SharedMediaKey &key);
 	rpl::producer<SharedMediaSliceUpdate> sharedMediaSliceUpdated() const;
 	rpl::producer<SharedMediaRemoveOne> sharedMediaOneRemoved() const;
 	rpl::producer<SharedMediaRemoveAll> sharedMediaAllRemoved() const;
 	rpl::producer<SharedMediaInvalidateBottom> sharedMediaBottomInvalidated() const;
+	void setSharedMediaRestore(Fn<void(PeerId)> restore);
+	void sharedMediaRestored(
+		PeerId peerId,
+		std::vector<QByteArray> &&serialized);
+	QByteArray sharedMediaSerialized(
+		PeerId peerId,
+		SharedMediaType type) const;
+	rpl::producer<SharedMediaChanged> sharedMediaChanged() const;
 
 	void add(UserPhotosSetBack &&query);
 	void add(UserPhotosAddNew &&query);
@@ -71,15 +79,15 @@ void Facade::Impl::unload(SharedMediaUnloadThread &&query) {
 	_sharedMedia.unload(std::move(query));
 }
 
-rpl::producer<SharedMediaResult> Facade::Impl::query(SharedMediaQuery &&query) const {
+rpl::producer<SharedMediaResult> Facade::Impl::query(SharedMediaQuery &&query) {
 	return _sharedMedia.query(std::move(query));
 }
 
-SharedMediaResult Facade::Impl::snapshot(const SharedMediaQuery &query) const {
+SharedMediaResult Facade::Impl::snapshot(const SharedMediaQuery &query) {
 	return _sharedMedia.snapshot(query);
 }
 
-bool Facade::Impl::empty(const SharedMediaKey &key) const {
+bool Facade::Impl::empty(const SharedMediaKey &key) {
 	return _sharedMedia.empty(key);
 }
 
@@ -99,6 +107,26 @@ rpl::producer<SharedMediaInvalidateBottom> Facade::Impl::sharedMediaBottomInvali
 	return _sharedMedia.bottomInvalidated();
 }
 
+void Facade::Impl::setSharedMediaRestore(Fn<void(PeerId)> restore) {
+	_sharedMedia.setRestore(std::move(restore));
+}
+
+void Facade::Impl::sharedMediaRestored(
+		PeerId peerId,
+		std::vector<QByteArray> &&serialized) {
+	_sharedMedia.restored(peerId, std::move(serialized));
+}
+
+QByteArray Facade::Impl::sharedMediaSerialized(
+		PeerId peerId,
+		SharedMediaType type) const {
+	return _sharedMedia.serialize(peerId, type);
+}
+
+rpl::producer<SharedMediaChanged> Facade::Impl::sharedMediaChanged() const {
+	return _sharedMedia.changed();
+}
+
 void Facade::Impl::add(UserPhotosSetBack &&query) {
 	return _userPhotos.add(std::move(query));
 }
@@ -186,6 +214,26 @@ rpl::producer<SharedMediaInvalidateBottom> Facade::sharedMediaBottomInvalidated(
 	return _impl->sharedMediaBottomInvalidated();
 }
 
+void Facade::setSharedMediaRestore(Fn<void(PeerId)> restore) {
+	_impl->setSharedMediaRestore(std::move(restore));
+}
+
+void Facade::sharedMediaRestored(
+		PeerId peerId,
+		std::vector<QByteArray> &&serialized) {
+	_impl->sharedMediaRestored(peerId, std::move(serialized));
+}
+
+QByteArray Facade::sharedMediaSerialized(
+		PeerId peerId,
+		SharedMediaType type) const {
+	return _impl->sharedMediaSerialized(peerId, type);
+}
+
+rpl::producer<SharedMediaChanged> Facade::sharedMediaChanged() const {
+	return _impl->sharedMediaChanged();
+}
+
 void Facade::add(UserPhotosSetBack &&query) {
 	return _impl->add(std::move(query));
 }
@@ -29,6 +29,8 @@ struct SharedMediaQuery;
 struct SharedMediaKey;
 using SharedMediaResult = SparseIdsListResult;
 struct SharedMediaSliceUpdate;
+struct SharedMediaChanged;
+enum class SharedMediaType : signed char;
 
 struct UserPhotosSetBack;
 struct UserPhotosAddNew;
@@ -58,6 +60,14 @@ public:
 	rpl::producer<SharedMediaRemoveOne> sharedMediaOneRemoved() const;
 	rpl::producer<SharedMediaRemoveAll> sharedMediaAllRemoved() const;
 	rpl::producer<SharedMediaInvalidateBottom> sharedMediaBottomInvalidated() const;
+	void setSharedMediaRestore(Fn<void(PeerId)> restore);
+	void sharedMediaRestored(
+		PeerId peerId,
+		std::vector<QByteArray> &&serialized);
+	QByteArray sharedMediaSerialized(
+		PeerId peerId,
+		SharedMediaType type) const;
+	rpl::producer<SharedMediaChanged> sharedMediaChanged() const;
 
 	void add(UserPhotosSetBack &&query);
 	void add(UserPhotosAddNew &&query);
@@ -11,8 +11,31 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Storage {
 
+namespace {
+
+constexpr auto kSerializeVersion = quint32(2);
+
+[[nodiscard]] bool RestoreList(
+		SparseIdsList &list,
+		const QByteArray &serialized,
+		const base::flat_set<MsgId> &removed) {
+	auto stream = QDataStream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto version = quint32();
+	stream >> version;
+	return (stream.status() == QDataStream::Ok)
+		&& (version == kSerializeVersion)
+		&& list.restore(stream, removed);
+}
+
+} // namespace
+
 auto SharedMedia::enforceLists(Key key)
 -> std::map<Key, SharedMedia::Lists>::iterator {
+	if (!key.topicRootId) {
+		restore(key.peerId);
+	}
 	auto result = _lists.find(key);
 	if (result != _lists.end()) {
 		return result;
@@ -50,6 +73,7 @@ void SharedMedia::add(SharedMediaAddNew &&query) {
 	if (topicIt != end(_lists)) {
 		addByIt(topicIt);
 	}
+	markChanged(query.peerId, MsgId(0), query.types);
 }
 
 void SharedMedia::add(SharedMediaAddExisting &&query) {
@@ -62,6 +86,7 @@ void SharedMedia::add(SharedMediaAddExisting &&query) {
 				query.noSkipRange);
 		}
 	}
+	markChanged(query.peerId, query.topicRootId, query.types);
 }
 
 void SharedMedia::add(SharedMediaAddSlice &&query) {
@@ -73,9 +98,11 @@ void SharedMedia::add(SharedMediaAddSlice &&query) {
 		std::move(query.messageIds),
 		query.noSkipRange,
 		query.count);
+	markChanged(query.peerId, query.topicRootId, query.type);
 }
 
 void SharedMedia::remove(SharedMediaRemoveOne &&query) {
+	restore(query.peerId);
 	auto peerIt = _lists.lower_bound({ query.peerId, MsgId(0) });
 	while (peerIt != end(_lists) && peerIt->first.peerId == query.peerId) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
@@ -86,10 +113,20 @@ void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 		}
 		++peerIt;
 	}
+	if (const auto i = _restoring.find(query.peerId); i != end(_restoring)) {
+		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+			auto type = static_cast<SharedMediaType>(index);
+			if (query.types.test(type)) {
+				i->second.removed[index].emplace(query.messageId);
+			}
+		}
+	}
+	markChanged(query.peerId, MsgId(0), query.types);
 	_oneRemoved.fire(std::move(query));
 }
 
 void SharedMedia::remove(SharedMediaRemoveAll &&query) {
+	restore(query.peerId);
 	auto peerIt = _lists.lower_bound({ query.peerId, query.topicRootId });
 	while (peerIt != end(_lists)
 		&& peerIt->first.peerId == query.peerId
@@ -103,10 +140,18 @@ void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 		}
 		++peerIt;
 	}
+	if (!query.topicRootId) {
+		const auto i = _restoring.find(query.peerId);
+		if (i != end(_restoring)) {
+			i->second.removedAll.set(query.types);
+		}
+	}
+	markChanged(query.peerId, query.topicRootId, query.types);
 	_allRemoved.fire(std::move(query));
 }
 
 void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
+	restore(query.peerId);
 	auto peerIt = _lists.lower_bound({ query.peerId, MsgId(0) });
 	while (peerIt != end(_lists) && peerIt->first.peerId == query.peerId) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
@@ -114,6 +159,7 @@ void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 		}
 		++peerIt;
 	}
+	markChanged(query.peerId, MsgId(0), SharedMediaTypesMask::All());
 	_bottomInvalidated.fire(std::move(query));
 }
 
@@ -121,9 +167,12 @@ void SharedMedia::unload(SharedMediaUnloadThread &&query) {
 	_lists.erase({ query.peerId, query.topicRootId });
 }
 
-rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) const {
+rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) {
 	Expects(IsValidSharedMediaType(query.key.type));
 
+	if (!query.key.topicRootId) {
+		restore(query.key.peerId);
+	}
 	auto peerIt = _lists.find({ query.key.peerId, query.key.topicRootId });
 	if (peerIt != _lists.end()) {
 		auto index = static_cast<int>(query.key.type);
@@ -138,9 +187,12 @@ rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) co
 	};
 }
 
-SharedMediaResult SharedMedia::snapshot(const SharedMediaQuery &query) const {
+SharedMediaResult SharedMedia::snapshot(const SharedMediaQuery &query) {
 	Expects(IsValidSharedMediaType(query.key.type));
 
+	if (!query.key.topicRootId) {
+		restore(query.key.peerId);
+	}
 	auto peerIt = _lists.find({ query.key.peerId, query.key.topicRootId });
 	if (peerIt != _lists.end()) {
 		auto index = static_cast<int>(query.key.type);
@@ -152,9 +204,12 @@ SharedMediaResult SharedMedia::snapshot(const SharedMediaQuery &query) const {
 	return {};
 }
 
-bool SharedMedia::empty(const SharedMediaKey &key) const {
+bool SharedMedia::empty(const SharedMediaKey &key) {
 	Expects(IsValidSharedMediaType(key.type));
 
+	if (!key.topicRootId) {
+		restore(key.peerId);
+	}
 	auto peerIt = _lists.find({ key.peerId, key.topicRootId });
 	if (peerIt != _lists.end()) {
 		auto index = static_cast<int>(key.type);
@@ -179,4 +234,90 @@ rpl::producer<SharedMediaInvalidateBottom> SharedMedia::bottomInvalidated() cons
 	return _bottomInvalidated.events();
 }
 
+void SharedMedia::setRestore(Fn<void(PeerId)> restore) {
+	_restore = std::move(restore);
+}
+
+void SharedMedia::restore(PeerId peerId) {
+	if (!_restore || !_restored.emplace(peerId).second) {
+		return;
+	}
+	_restoring.emplace(peerId);
+	_restore(peerId);
+}
+
+void SharedMedia::restored(
+		PeerId peerId,
+		std::vector<QByteArray> &&serialized) {
+	const auto i = _restoring.find(peerId);
+	if (i == end(_restoring)) {
+		return;
+	}
+	auto restoring = std::move(i->second);
+	_restoring.erase(i);
+
+	auto &lists = enforceLists({ peerId, MsgId(0) })->second;
+	const auto count = std::min(
+		int(serialized.size()),
+		kSharedMediaTypeCount);
+	for (auto index = 0; index != count; ++index) {
+		const auto type = static_cast<SharedMediaType>(index);
+		if (serialized[index].isEmpty() || restoring.removedAll.test(type)) {
+			continue;
+		} else if (!RestoreList(
+				lists[index],
+				serialized[index],
+				restoring.removed[index])) {
+			LOG(("Storage Error: Could not restore shared media for %1."
+				).arg(peerId.value));
+			restoring.changed.set(type);
+		}
+	}
+	markChanged(peerId, MsgId(0), restoring.changed);
+}
+
+QByteArray SharedMedia::serialize(PeerId peerId, Type type) const {
+	Expects(IsValidSharedMediaType(type));
+
+	const auto i = _lists.find({ peerId, MsgId(0) });
+	if (i == end(_lists)) {
+		return QByteArray();
+	}
+	const auto &list = i->second[static_cast<int>(type)];
+	if (list.empty()) {
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << kSerializeVersion;
+		list.serialize(stream);
+	}
+	return result;
+}
+
+void SharedMedia::markChanged(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaTypesMask types) {
+	if (topicRootId) {
+		return;
+	} else if (const auto i = _restoring.find(peerId)
+		; i != end(_restoring)) {
+		i->second.changed.set(types);
+		return;
+	}
+	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+		const auto type = static_cast<SharedMediaType>(index);
+		if (types.test(type)) {
+			_changed.fire({ peerId, type });
+		}
+	}
+}
+
+rpl::producer<SharedMediaChanged> SharedMedia::changed() const {
+	return _changed.events();
+}
+
 } // namespace Storage
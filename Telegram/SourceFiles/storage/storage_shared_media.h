@@ -221,6 +221,11 @@ struct SharedMediaUnloadThread {
 	MsgId topicRootId = 0;
 };
 
+struct SharedMediaChanged {
+	PeerId peerId = 0;
+	SharedMediaType type = SharedMediaType::kCount;
+};
+
 class SharedMedia {
 public:
 	using Type = SharedMediaType;
@@ -233,14 +238,22 @@ public:
 	void invalidate(SharedMediaInvalidateBottom &&query);
 	void unload(SharedMediaUnloadThread &&query);
 
-	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query) const;
-	SharedMediaResult snapshot(const SharedMediaQuery &query) const;
-	bool empty(const SharedMediaKey &key) const;
+	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query);
+	SharedMediaResult snapshot(const SharedMediaQuery &query);
+	bool empty(const SharedMediaKey &key);
 	rpl::producer<SharedMediaSliceUpdate> sliceUpdated() const;
 	rpl::producer<SharedMediaRemoveOne> oneRemoved() const;
 	rpl::producer<SharedMediaRemoveAll> allRemoved() const;
 	rpl::producer<SharedMediaInvalidateBottom> bottomInvalidated() const;
 
+	// Whole peer lists (without topics) are stored in the local storage,
+	// each type separately. They're requested when the peer lists are
+	// accessed first time and merged with the loaded ones in restored().
+	void setRestore(Fn<void(PeerId)> restore);
+	void restored(PeerId peerId, std::vector<QByteArray> &&serialized);
+	[[nodiscard]] QByteArray serialize(PeerId peerId, Type type) const;
+	[[nodiscard]] rpl::producer<SharedMediaChanged> changed() const;
+
 private:
 	struct Key {
 		PeerId peerId = 0;
@@ -250,10 +263,27 @@ private:
 	};
 	using Lists = std::array<SparseIdsList, kSharedMediaTypeCount>;
 
+	// Changes made while the stored lists are being read.
+	struct Restoring {
+		SharedMediaTypesMask changed;
+		SharedMediaTypesMask removedAll;
+		std::array<base::flat_set<MsgId>, kSharedMediaTypeCount> removed;
+	};
+
 	std::map<Key, Lists>::iterator enforceLists(Key key);
+	void restore(PeerId peerId);
+	void markChanged(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaTypesMask types);
 
 	std::map<Key, Lists> _lists;
 
+	Fn<void(PeerId)> _restore;
+	base::flat_set<PeerId> _restored;
+	base::flat_map<PeerId, Restoring> _restoring;
+	rpl::event_stream<SharedMediaChanged> _changed;
+
 	rpl::event_stream<SharedMediaSliceUpdate> _sliceUpdated;
 	rpl::event_stream<SharedMediaRemoveOne> _oneRemoved;
 	rpl::event_stream<SharedMediaRemoveAll> _allRemoved;
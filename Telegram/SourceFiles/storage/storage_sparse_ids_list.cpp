@@ -184,6 +184,65 @@ void SparseIdsList::invalidateBottom() {
 	_count = std::nullopt;
 }
 
+void SparseIdsList::serialize(QDataStream &stream) const {
+	stream << quint32(_slices.size());
+	for (const auto &slice : _slices) {
+		stream
+			<< qint64(slice.range.from.bare)
+			<< qint64(slice.range.till.bare)
+			<< quint32(slice.messages.size());
+		for (const auto messageId : slice.messages) {
+			stream << qint64(messageId.bare);
+		}
+	}
+}
+
+bool SparseIdsList::restore(
+		QDataStream &stream,
+		const base::flat_set<MsgId> &removed) {
+	auto slicesCount = quint32();
+	stream >> slicesCount;
+	if (stream.status() != QDataStream::Ok) {
+		return false;
+	}
+	auto slices = std::vector<Slice>();
+	slices.reserve(slicesCount);
+	for (auto i = quint32(); i != slicesCount; ++i) {
+		auto from = qint64();
+		auto till = qint64();
+		auto size = quint32();
+		stream >> from >> till >> size;
+		if (stream.status() != QDataStream::Ok || from > till) {
+			return false;
+		}
+		auto messages = base::flat_set<MsgId>();
+		messages.reserve(size);
+		for (auto j = quint32(); j != size; ++j) {
+			auto messageId = qint64();
+			stream >> messageId;
+			if (!removed.contains(messageId)) {
+				messages.emplace(messageId);
+			}
+		}
+		if (stream.status() != QDataStream::Ok) {
+			return false;
+		}
+		slices.emplace_back(std::move(messages), MsgRange{ from, till });
+	}
+
+	// Like invalidateBottom(), new messages are requested again.
+	if (!slices.empty() && slices.back().range.till == ServerMaxMsgId) {
+		auto &slice = slices.back();
+		slice.range.till = slice.messages.empty()
+			? slice.range.from
+			: slice.messages.back();
+	}
+	for (const auto &slice : slices) {
+		addRange(slice.messages, slice.range, std::nullopt, false);
+	}
+	return true;
+}
+
 rpl::producer<SparseIdsListResult> SparseIdsList::query(
 		SparseIdsListQuery &&query) const {
 	return [this, query = std::move(query)](auto consumer) {
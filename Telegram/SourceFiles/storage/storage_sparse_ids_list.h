@@ -54,6 +54,17 @@ public:
 	SparseIdsListResult snapshot(const SparseIdsListQuery &query) const;
 	bool empty() const;
 
+	// The total count is not stored, it is requested from the server.
+	void serialize(QDataStream &stream) const;
+
+	// Restored slices are merged with the already loaded ones, skipping
+	// the removed messages. The bottom of the restored list is considered
+	// unknown, because new messages could've been added while it was
+	// stored.
+	bool restore(
+		QDataStream &stream,
+		const base::flat_set<MsgId> &removed);
+
 private:
 	struct Slice {
 		Slice(base::flat_set<MsgId> &&messages, MsgRange range);
@@ -17,6 +17,12 @@ using namespace Images;
 namespace Images {
 namespace {
 
+constexpr auto kPixmapCacheLimitDefault = int64(128 * 1024 * 1024);
+
+[[nodiscard]] int64 PixmapBytes(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * (pixmap.depth() / 8);
+}
+
 [[nodiscard]] uint64 PixKey(int width, int height, Options options) {
 	return static_cast<uint64>(width)
 		| (static_cast<uint64>(height) << 24)
@@ -41,6 +47,166 @@ namespace {
 
 } // namespace
 
+class PixmapCache final {
+public:
+	[[nodiscard]] static PixmapCache &Instance();
+
+	void used(not_null<const Image*> image, uint64 key, int64 bytes);
+	void added(not_null<const Image*> image, uint64 key, int64 bytes);
+	void removed(not_null<const Image*> image);
+
+	void setLimit(int64 bytes);
+	void shrink();
+	[[nodiscard]] PixmapCacheStats stats() const;
+
+private:
+	struct Entry {
+		not_null<const Image*> image;
+		uint64 key = 0;
+		int64 bytes = 0;
+	};
+	using Entries = std::list<Entry>;
+
+	void erase(Entries::iterator i);
+	void checkLimit();
+	void trim(int64 till);
+
+	// From the least recently used to the most recently used.
+	Entries _entries;
+	std::map<std::pair<const Image*, uint64>, Entries::iterator> _index;
+
+	PixmapCacheStats _stats = { .limit = kPixmapCacheLimitDefault };
+	bool _trimScheduled = false;
+
+};
+
+PixmapCache &PixmapCache::Instance() {
+	// Never destroyed, static images may outlive any other static.
+	static const auto result = new PixmapCache();
+	return *result;
+}
+
+void PixmapCache::used(
+		not_null<const Image*> image,
+		uint64 key,
+		int64 bytes) {
+	const auto i = _index.find({ image.get(), key });
+	if (i == end(_index)) {
+		added(image, key, bytes);
+		return;
+	}
+	++_stats.hits;
+	_entries.splice(end(_entries), _entries, i->second);
+}
+
+void PixmapCache::added(
+		not_null<const Image*> image,
+		uint64 key,
+		int64 bytes) {
+	++_stats.misses;
+	const auto i = _index.find({ image.get(), key });
+	if (i != end(_index)) {
+		erase(i->second);
+	}
+	_entries.push_back({ image, key, bytes });
+	_index.emplace(std::make_pair(image.get(), key), std::prev(end(_entries)));
+	_stats.bytes += bytes;
+	checkLimit();
+}
+
+void PixmapCache::removed(not_null<const Image*> image) {
+	auto i = _index.lower_bound({ image.get(), 0 });
+	while (i != end(_index) && i->first.first == image) {
+		_stats.bytes -= i->second->bytes;
+		_entries.erase(i->second);
+		i = _index.erase(i);
+	}
+}
+
+void PixmapCache::erase(Entries::iterator i) {
+	_stats.bytes -= i->bytes;
+	_index.erase({ i->image.get(), i->key });
+	_entries.erase(i);
+}
+
+void PixmapCache::setLimit(int64 bytes) {
+	_stats.limit = bytes;
+	checkLimit();
+}
+
+void PixmapCache::shrink() {
+	trim(_stats.limit / 4);
+}
+
+PixmapCacheStats PixmapCache::stats() const {
+	return _stats;
+}
+
+void PixmapCache::checkLimit() {
+	if (_stats.bytes <= _stats.limit || _trimScheduled) {
+		return;
+	}
+	// Callers may still hold references to the pixmaps they've just got,
+	// so the cache is trimmed only after the current event is processed.
+	_trimScheduled = true;
+	crl::on_main([=] {
+		_trimScheduled = false;
+		trim(_stats.limit);
+	});
+}
+
+void PixmapCache::trim(int64 till) {
+	while (_stats.bytes > till && !_entries.empty()) {
+		const auto &entry = _entries.front();
+		entry.image->_cache.remove(entry.key);
+		++_stats.evictions;
+		erase(begin(_entries));
+	}
+}
+
+void SetPixmapCacheLimit(int64 bytes) {
+	PixmapCache::Instance().setLimit(bytes);
+}
+
+void ShrinkPixmapCache() {
+	PixmapCache::Instance().shrink();
+}
+
+PixmapCacheStats PixmapCacheStatistics() {
+	return PixmapCache::Instance().stats();
+}
+
+void PrepareAsync(AsyncPrepareRequest &&request) {
+	Expects(request.prepare != nullptr);
+	Expects(request.done != nullptr);
+
+	using Key = std::pair<qint64, uint64>;
+	static auto InFlight = base::flat_map<Key, std::vector<Fn<void(QImage)>>>();
+
+	const auto key = Key(request.original.cacheKey(), request.key);
+	auto &waiting = InFlight[key];
+	waiting.push_back(std::move(request.done));
+	if (waiting.size() > 1) {
+		return;
+	}
+	crl::async([
+		key,
+		original = std::move(request.original),
+		prepare = std::move(request.prepare)
+	]() mutable {
+		auto result = prepare(std::move(original));
+		crl::on_main([key, result = std::move(result)] {
+			const auto i = InFlight.find(key);
+			Assert(i != end(InFlight));
+			const auto callbacks = std::move(i->second);
+			InFlight.erase(i);
+			for (const auto &callback : callbacks) {
+				callback(result);
+			}
+		});
+	});
+}
+
 } // namespace Images
 
 Image::Image(const QString &path)
@@ -56,6 +222,12 @@ Image::Image(QImage &&data)
 	Expects(!_data.isNull());
 }
 
+Image::~Image() {
+	if (!_cache.empty()) {
+		PixmapCache::Instance().removed(this);
+	}
+}
+
 not_null<Image*> Image::Empty() {
 	static auto result = Image([] {
 		const auto factor = cIntRetinaFactor();
@@ -106,10 +278,17 @@ const QPixmap &Image::cached(
 	const auto outer = args.outer;
 	const auto size = outer.isEmpty() ? QSize(w, h) : outer * ratio;
 	const auto k = single ? SinglePixKey(args) : PixKey(w, h, args);
+	auto &cache = PixmapCache::Instance();
 	const auto i = _cache.find(k);
-	return (i != _cache.cend() && i->second.size() == size)
-		? i->second
-		: _cache.emplace_or_assign(k, prepare(w, h, args)).first->second;
+	if (i != _cache.cend() && i->second.size() == size) {
+		cache.used(this, k, PixmapBytes(i->second));
+		return i->second;
+	}
+	const auto &result = _cache.emplace_or_assign(
+		k,
+		prepare(w, h, args)).first->second;
+	cache.added(this, k, PixmapBytes(result));
+	return result;
 }
 
 QPixmap Image::prepare(int w, int h, const Images::PrepareArgs &args) const {
@@ -11,11 +11,43 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 class QPainterPath;
 
+namespace Images {
+
+class PixmapCache;
+
+struct PixmapCacheStats {
+	int64 bytes = 0;
+	int64 limit = 0;
+	int64 hits = 0;
+	int64 misses = 0;
+	int64 evictions = 0;
+};
+
+// Scaled pixmaps of all Image instances share one memory budget,
+// the least recently used ones are dropped when it is exceeded.
+void SetPixmapCacheLimit(int64 bytes);
+void ShrinkPixmapCache();
+[[nodiscard]] PixmapCacheStats PixmapCacheStatistics();
+
+struct AsyncPrepareRequest {
+	QImage original;
+	uint64 key = 0; // Same original with the same key give the same result.
+	Fn<QImage(QImage)> prepare; // Called on a background thread.
+	Fn<void(QImage)> done; // Called on the main thread.
+};
+
+// Requests for the same original and key that are still in flight
+// are coalesced, each of them gets the same result.
+void PrepareAsync(AsyncPrepareRequest &&request);
+
+} // namespace Images
+
 class Image final {
 public:
 	explicit Image(const QString &path);
 	explicit Image(const QByteArray &content);
 	explicit Image(QImage &&data);
+	~Image();
 
 	[[nodiscard]] static not_null<Image*> Empty(); // 1x1 transparent
 	[[nodiscard]] static not_null<Image*> BlankMedia(); // 1x1 black
@@ -88,6 +120,8 @@ public:
 	}
 
 private:
+	friend class Images::PixmapCache;
+
 	[[nodiscard]] QPixmap prepare(
 		int w,
 		int h,